@@ -0,0 +1,102 @@
+// 张; 杨
+#include "base/kaldi-common.h"
+#include "base/timer.h"
+#include "util/common-utils.h"
+#include "onlinedecoder/audio-buffer-source.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace kaldi;
+
+// the per-sample conversion ReadData used before, kept as the baseline: one
+// bounds check and a possible buffer switch for every sample
+static void ReadPerSample(const std::vector<std::vector<SampleType> > &buffers,
+                          int32 chunk_length, Vector<BaseFloat> *chunk) {
+  size_t buf = 0;
+  int32 pos = 0;
+  while (buf < buffers.size()) {
+    for (int32 i = 0; i < chunk_length && buf < buffers.size(); i++) {
+      (*chunk)(i) = static_cast<BaseFloat>(buffers[buf][pos]);
+      pos++;
+      if (pos >= static_cast<int32>(buffers[buf].size())) {
+        buf++;
+        pos = 0;
+      }
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  try {
+    const char *usage =
+        "Measure the int16 to float conversion of AudioBufferSource::ReadData,\n"
+        "against the per-sample loop it replaced.\n"
+        "\n"
+        "Usage: audio-buffer-source-bench [options]\n";
+    ParseOptions po(usage);
+    BaseFloat num_seconds = 600.0;
+    int32 packet_size = 160, chunk_length = 800, sample_rate = 16000;
+    po.Register("num-seconds", &num_seconds, "Amount of audio to convert");
+    po.Register("packet-size", &packet_size, "Samples per received buffer");
+    po.Register("chunk-length", &chunk_length, "Samples per ReadData call");
+    po.Register("sample-rate", &sample_rate, "Sample rate, only used to report the real time factor");
+    po.Read(argc, argv);
+    if (po.NumArgs() != 0) {
+      po.PrintUsage();
+      return 1;
+    }
+    if (packet_size <= 0 || chunk_length <= 0 || sample_rate <= 0)
+      KALDI_ERR << "--packet-size, --chunk-length and --sample-rate must be positive";
+
+    int32 num_packets = static_cast<int32>(num_seconds * sample_rate / packet_size);
+    std::vector<std::vector<SampleType> > packets(num_packets,
+                                                  std::vector<SampleType>(packet_size));
+    for (int32 p = 0; p < num_packets; p++)
+      for (int32 i = 0; i < packet_size; i++)
+        packets[p][i] = static_cast<SampleType>(rand() % 65536 - 32768);
+    double num_samples = static_cast<double>(num_packets) * packet_size;
+
+    Vector<BaseFloat> chunk(chunk_length);
+    Timer timer;
+    ReadPerSample(packets, chunk_length, &chunk);
+    double per_sample_secs = timer.Elapsed();
+
+    // the same data through the real AudioBufferSource, pooled buffers included
+    AudioBufferSource source;
+    timer.Reset();
+    for (int32 p = 0; p < num_packets; p++) {
+      AudioBuffer *buffer = source.BufferPool().Acquire(packet_size);
+      source.BufferPool().TakeAcquired(buffer->pData_);
+      buffer->spkr_ = "bench";
+      std::copy(packets[p].begin(), packets[p].end(), buffer->pData_);
+      source.ReceiveData(buffer);
+      // read as soon as a chunk is there, like the decoder does
+      while (source.DataReady(chunk_length)) {
+        chunk.Resize(chunk_length, kUndefined);
+        std::string spk;
+        source.ReadData(&chunk, spk);
+      }
+    }
+    double read_data_secs = timer.Elapsed();
+
+    // a packet of its own, as ReadData may have shrunk chunk
+    Vector<BaseFloat> packet(packet_size, kUndefined);
+    timer.Reset();
+    for (int32 p = 0; p < num_packets; p++)
+      ConvertSamplesToFloat(&(packets[p][0]), packet_size, packet.Data());
+    double convert_secs = timer.Elapsed();
+
+    KALDI_LOG << "Per-sample loop:       " << num_samples / per_sample_secs / 1.0e6
+              << " Msamples/s";
+    KALDI_LOG << "ConvertSamplesToFloat: " << num_samples / convert_secs / 1.0e6
+              << " Msamples/s, " << per_sample_secs / convert_secs << "x";
+    KALDI_LOG << "ReadData (end to end): " << num_samples / read_data_secs / 1.0e6
+              << " Msamples/s, real time factor "
+              << read_data_secs / (num_samples / sample_rate);
+    return 0;
+  } catch (const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -1,38 +1,151 @@
 // 张; 杨
 #include "onlinedecoder/audio-buffer-source.h"
+#include <algorithm>
 #include <chrono>
+#include <thread>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 namespace kaldi {
 
+void ConvertSamplesToFloat(const SampleType* in, int32 num_samples, BaseFloat* out)
+{
+  int32 i = 0;
+#if defined(__AVX2__) && !KALDI_DOUBLEPRECISION
+  for (; i + 8 <= num_samples; i += 8) {
+    __m128i s16 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    _mm256_storeu_ps(out + i, _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(s16)));
+  }
+#elif defined(__SSE2__) && !KALDI_DOUBLEPRECISION
+  for (; i + 8 <= num_samples; i += 8) {
+    __m128i s16 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    // sign extend by putting each sample in the high half and shifting down
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s16, s16), 16);
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s16, s16), 16);
+    _mm_storeu_ps(out + i, _mm_cvtepi32_ps(lo));
+    _mm_storeu_ps(out + i + 4, _mm_cvtepi32_ps(hi));
+  }
+#endif
+  for (; i < num_samples; i++)
+    out[i] = static_cast<BaseFloat>(in[i]);
+}
+
+void ReleaseAudioBuffer(AudioBuffer* pBuffer)
+{
+  if (pBuffer->pool_ != NULL) {
+    pBuffer->pool_->Recycle(pBuffer);
+    return;
+  }
+  if (pBuffer->release_ != NULL)
+    pBuffer->release_(pBuffer->pData_, pBuffer->release_arg_);
+  else
+    delete[] pBuffer->pData_;
+  delete pBuffer;
+}
+
+AudioBuffer* AudioBufferPool::Acquire(int32 size)
+{
+  AudioBuffer* pBuffer = this->Get(size);
+  std::lock_guard<std::mutex> producer_locker(producer_mtx_);
+  acquired_.push_back(pBuffer);
+  return pBuffer;
+}
+
+AudioBuffer* AudioBufferPool::Get(int32 size)
+{
+  std::lock_guard<std::mutex> producer_locker(producer_mtx_);
+  AudioBuffer* pBuffer = NULL;
+  if (!spare_.empty()) {
+    pBuffer = spare_.back();
+    spare_.pop_back();
+  } else if (!recycled_.TryPop(&pBuffer)) {
+    pBuffer = new AudioBuffer();
+    pBuffer->pool_ = this;
+  }
+  if (pBuffer->capacity_ < size) {
+    delete[] pBuffer->pData_;
+    pBuffer->pData_ = new SampleType[size];
+    pBuffer->capacity_ = size;
+  }
+  pBuffer->size_ = size;
+  return pBuffer;
+}
+
+AudioBuffer* AudioBufferPool::TakeAcquired(const SampleType* pData)
+{
+  std::lock_guard<std::mutex> producer_locker(producer_mtx_);
+  for (size_t i = 0; i < acquired_.size(); i++) {
+    if (acquired_[i]->pData_ == pData) {
+      AudioBuffer* pBuffer = acquired_[i];
+      acquired_.erase(acquired_.begin() + i);
+      return pBuffer;
+    }
+  }
+  return NULL;
+}
+
+void AudioBufferPool::Discard(AudioBuffer* pBuffer)
+{
+  std::lock_guard<std::mutex> producer_locker(producer_mtx_);
+  spare_.push_back(pBuffer);
+}
+
+void AudioBufferPool::Recycle(AudioBuffer* pBuffer)
+{
+  // if the producer is not taking buffers back, there are enough of them around
+  if (!recycled_.TryPush(pBuffer)) {
+    delete[] pBuffer->pData_;
+    delete pBuffer;
+  }
+}
+
+AudioBufferPool::~AudioBufferPool()
+{
+  AudioBuffer* pBuffer = NULL;
+  while (recycled_.TryPop(&pBuffer))
+    spare_.push_back(pBuffer);
+  spare_.insert(spare_.end(), acquired_.begin(), acquired_.end());
+  for (size_t i = 0; i < spare_.size(); i++) {
+    delete[] spare_[i]->pData_;
+    delete spare_[i];
+  }
+}
+
 // put a buffer in the queue
 void AudioBufferSource::EnqueueBuffer(AudioBuffer* pBuffer)
 {
-  // lock the mutex to guard the buffer queue for writting
-  std::lock_guard<std::mutex> mtx_locker(buffer_mtx_);
-  data_buffer_queue_.push(pBuffer);
-  buffer_cond_.notify_one();
+  // the reader may free the buffer as soon as it is in the ring
+  int32 num_samples = pBuffer->size_;
+  while (!buffer_ring_.TryPush(pBuffer)) {
+    // the ring is full, wait for the decoder to catch up
+    std::this_thread::yield();
+  }
+  num_samples_ready_ += num_samples;
+  num_samples_received_ += num_samples;
+  // only wake the reader if it found the ring empty
+  if (consumer_waiting_) {
+    std::lock_guard<std::mutex> mtx_locker(buffer_mtx_);
+    buffer_cond_.notify_one();
+  }
 }
 
 // get g buffer from the queue, if the queue is empty and is not ended, wait until a buffer is available
 AudioBuffer* AudioBufferSource::DequeueBuffer()
 {
-  // lock the mutex to guard the buffer queue for reading
+  AudioBuffer* pBuffer = NULL;
+  if (buffer_ring_.TryPop(&pBuffer) || ended_ == true || read_cancelled_ == true)
+    return pBuffer;
+  // announce that we are going to sleep before checking the ring again,
+  // so that a buffer pushed in between wakes us
   std::unique_lock<std::mutex> mtx_locker(buffer_mtx_);
-  if (data_buffer_queue_.empty() && ended_ == true) {
-	  return NULL;
-	}
+  consumer_waiting_ = true;
   // wait until there is a buffer available or the queue is ended
-  buffer_cond_.wait_for(mtx_locker, std::chrono::seconds(2), [this] {return (!this->data_buffer_queue_.empty() || this->ended_); });
-  if (data_buffer_queue_.empty())
-  {
-    return NULL;
-  }
-  else
-  {
-    AudioBuffer* pBuffer = data_buffer_queue_.front();
-    data_buffer_queue_.pop();
-    return pBuffer;
-  }
+  buffer_cond_.wait_for(mtx_locker, std::chrono::seconds(2), [this] {
+    return (!this->buffer_ring_.Empty() || this->ended_ || this->read_cancelled_); });
+  consumer_waiting_ = false;
+  buffer_ring_.TryPop(&pBuffer);
+  return pBuffer;
 }
 
 AudioState AudioBufferSource::ReadData(Vector<BaseFloat>* data, std::string& spk){
@@ -42,12 +155,19 @@ AudioState AudioBufferSource::ReadData(Vector<BaseFloat>* data, std::string& spk
 	  current_spkr = cur_buffer_->spkr_;
   }
   if (cur_buffer_ == NULL || pos_in_current_buf_ == cur_buffer_->size_) {
+	  AudioBuffer* next_buffer = this->DequeueBuffer();
+	  if (next_buffer == NULL && read_cancelled_ == true && ended_ == false)
+	  {
+		  // keep the read buffer, the next call compares its speaker
+		  data->Resize(0);
+		  spk = current_spkr;
+		  return AudioState::SpkrContinue;
+	  }
 	  if (cur_buffer_ != NULL)
 	  {
-		  delete cur_buffer_->pData_;
-		  delete cur_buffer_;
+		  ReleaseAudioBuffer(cur_buffer_);
 	  }
-	  cur_buffer_ = this->DequeueBuffer();
+	  cur_buffer_ = next_buffer;
 	  
 	  if (cur_buffer_ == NULL)
 	  {
@@ -76,46 +196,64 @@ AudioState AudioBufferSource::ReadData(Vector<BaseFloat>* data, std::string& spk
   if (current_spkr == "")
 	  current_spkr = cur_buffer_->spkr_;
 
-  // get the chunk_length of the required data
+  // get the chunk_length of the required data, copying whole spans of each
+  // buffer; buffer and speaker changes are only checked between spans
   int32 chunk_length = data->Dim();
-  for(int32 i = 0; i < chunk_length; i++) {
-    (*data)(i) = static_cast<BaseFloat>(cur_buffer_->pData_[pos_in_current_buf_]);
-    pos_in_current_buf_++;
-    if (pos_in_current_buf_ >= cur_buffer_->size_) {
-	    delete cur_buffer_->pData_;
-	    delete cur_buffer_;
-      cur_buffer_ = NULL;
-	    cur_buffer_ = this->DequeueBuffer();
-	    if (cur_buffer_ == NULL)
-	    {
-		    data->Resize(i, kCopyData);
-		    spk = current_spkr;
-        if (ended_ == true)
-		      return AudioState::AudioEnd;
-        else
-          return AudioState::SpkrEnd;
-	    }
-	    else
-	    {
-		    pos_in_current_buf_ = 0;
-		    if (current_spkr != cur_buffer_->spkr_)
-		    {
-			    data->Resize(i, kCopyData);
-			    spk = current_spkr;
-			    return AudioState::SpkrEnd;
-		    }
-	    }
+  int32 num_read = 0;
+  while (true) {
+    int32 span = std::min(chunk_length - num_read, cur_buffer_->size_ - pos_in_current_buf_);
+    ConvertSamplesToFloat(cur_buffer_->pData_ + pos_in_current_buf_, span,
+                          data->Data() + num_read);
+    num_read += span;
+    pos_in_current_buf_ += span;
+    // the next buffer of a full chunk is fetched by the next call, so a chunk
+    // ending on a buffer boundary doesn't wait for more audio
+    if (num_read == chunk_length)
+      break;
+    AudioBuffer* next_buffer = this->DequeueBuffer();
+    if (next_buffer == NULL && read_cancelled_ == true && ended_ == false)
+    {
+	    num_samples_ready_ -= num_read;
+	    data->Resize(num_read, kCopyData);
+	    spk = current_spkr;
+	    return AudioState::SpkrContinue;
+    }
+    ReleaseAudioBuffer(cur_buffer_);
+    cur_buffer_ = next_buffer;
+    if (cur_buffer_ == NULL)
+    {
+	    num_samples_ready_ -= num_read;
+	    data->Resize(num_read, kCopyData);
+	    spk = current_spkr;
+      if (ended_ == true)
+	      return AudioState::AudioEnd;
+      else
+        return AudioState::SpkrEnd;
+    }
+    pos_in_current_buf_ = 0;
+    if (current_spkr != cur_buffer_->spkr_)
+    {
+	    num_samples_ready_ -= num_read;
+	    data->Resize(num_read, kCopyData);
+	    spk = current_spkr;
+	    return AudioState::SpkrEnd;
     }
   }
 
+  num_samples_ready_ -= chunk_length;
   spk = current_spkr;
   return AudioState::SpkrContinue;
 }
 
 // External Interface: put the data buffer in the queue is it is not ENDED!
 void AudioBufferSource::ReceiveData(AudioBuffer* pBuffer){
+  std::lock_guard<std::mutex> producer_locker(producer_mtx_);
   if (ended_ == false)
 	  this->EnqueueBuffer(pBuffer);
+  else if (pBuffer->pool_ != NULL)
+	  pBuffer->pool_->Discard(pBuffer);
+  else
+	  ReleaseAudioBuffer(pBuffer);
 }
 
 void AudioBufferSource::SetEnded(bool ended) {
@@ -130,22 +268,25 @@ void AudioBufferSource::SetEnded(bool ended) {
 	ended_ = ended;
 }
 
+void AudioBufferSource::CancelRead() {
+	std::lock_guard<std::mutex> mtx_locker(buffer_mtx_);
+	read_cancelled_ = true;
+	buffer_cond_.notify_one();
+}
+
 // TODO: write some protection code to prevent possible crash 
 //       when the buffer is not empty and there is still data reading in other thread
 AudioBufferSource::~AudioBufferSource(){
   if (ended_ == false)
 	  SetEnded(true);
-  if (!cur_buffer_) {
-	  delete cur_buffer_->pData_;
-	  delete cur_buffer_;
+  if (cur_buffer_ != NULL) {
+	  ReleaseAudioBuffer(cur_buffer_);
     cur_buffer_ = NULL;
   }
 
-  while(data_buffer_queue_.size() > 0)
+  while(buffer_ring_.TryPop(&cur_buffer_))
   {
-	  cur_buffer_ = data_buffer_queue_.back();
-	  delete cur_buffer_->pData_;
-	  delete cur_buffer_;
+	  ReleaseAudioBuffer(cur_buffer_);
 	  cur_buffer_ = NULL;
   }
 }
@@ -4,11 +4,13 @@
 
 #include <fstream>
 #include <iostream>
-#include <queue>
+#include <atomic>
 #include <mutex>
 #include <string>
+#include <vector>
 #include <condition_variable>
 #include "matrix/kaldi-vector.h"
+#include "onlinedecoder/spsc-ring.h"
 
 namespace kaldi {
 
@@ -21,21 +23,90 @@ enum AudioState {
  AudioEnd
 };
 
+// called with the samples and release_arg_ when the decoder is done with a
+// buffer whose samples are owned by the caller
+typedef void (*AudioBufferRelease)(const SampleType* pData, void* arg);
+
+class AudioBufferPool;
+
 // Buffer definition
+// the samples are freed according to who owns them: pool_ takes the buffer
+// back, release_ is called for caller owned samples, and otherwise pData_
+// was allocated with new[]
 struct AudioBuffer {
  std::string spkr_;
  SampleType* pData_;
  int size_;
+ int capacity_;
+ AudioBufferPool* pool_;
+ AudioBufferRelease release_;
+ void* release_arg_;
  
- AudioBuffer(): pData_(NULL), size_(0) {}
+ AudioBuffer(): pData_(NULL), size_(0), capacity_(0), pool_(NULL), release_(NULL), release_arg_(NULL) {}
 };
+
+// Per-recognizer pool of sample buffers, so that steady state ingestion
+// allocates nothing. Acquire, TakeAcquired and Discard are called by the
+// producers (the threads calling ReceiveData), which take turns on a mutex;
+// Recycle is called by the reader, and buffers come back to the producers
+// through a lock-free ring.
+class AudioBufferPool {
+ public:
+  AudioBufferPool(): recycled_(kRecycleRingCapacity) {}
+
+  // a buffer with room for at least size samples; it stays outstanding until
+  // it is handed to ReceiveData after TakeAcquired, or discarded
+  AudioBuffer* Acquire(int32 size);
+
+  // like Acquire, for a caller that hands the buffer to ReceiveData or
+  // Discard itself, so it is not tracked as outstanding
+  AudioBuffer* Get(int32 size);
+
+  // find and remove the outstanding buffer whose samples start at pData,
+  // NULL if there is none
+  AudioBuffer* TakeAcquired(const SampleType* pData);
+
+  // producer side: give back a buffer that was never queued
+  void Discard(AudioBuffer* pBuffer);
+
+  // reader side: give back a consumed buffer
+  void Recycle(AudioBuffer* pBuffer);
+
+  ~AudioBufferPool();
+
+ private:
+  static const size_t kRecycleRingCapacity = 256;
+
+  SpscRing<AudioBuffer*> recycled_;
+  // only touched by the producers, holding producer_mtx_; the consumer side
+  // of recycled_ is guarded by it too
+  std::mutex producer_mtx_;
+  std::vector<AudioBuffer*> spare_;
+  std::vector<AudioBuffer*> acquired_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(AudioBufferPool);
+};
+
+// free a consumed buffer the way its owner asks for
+void ReleaseAudioBuffer(AudioBuffer* pBuffer);
+
+// out[i] = in[i] for num_samples samples, vectorized with AVX2 or SSE2 when
+// the compiler targets them
+void ConvertSamplesToFloat(const SampleType* in, int32 num_samples, BaseFloat* out);
   
 // AudioBufferSource implementation using a queue of Gst Buffers
 // Reference: gst_audio_source
+// The buffers pass through a lock-free single-producer/single-consumer ring.
+// ReceiveData may be called from any thread: concurrent producers take turns
+// on producer_mtx_, which is uncontended when the audio of a recognizer comes
+// from one thread. ReadData must only be called from the decoding thread (or
+// the pool task) of the recognizer and never locks while audio is queued.
 class AudioBufferSource {
  public:
   
-  AudioBufferSource(): ended_(false), cur_buffer_(NULL), pos_in_current_buf_(0) {}
+  AudioBufferSource(): ended_(false), read_cancelled_(false), buffer_ring_(kBufferRingCapacity),
+                       consumer_waiting_(false), cur_buffer_(NULL), pos_in_current_buf_(0), num_samples_ready_(0),
+                       num_samples_received_(0) {}
 
   // read data from audiobuffer
   // return: 
@@ -46,8 +117,28 @@ class AudioBufferSource {
 
   void ReceiveData(AudioBuffer* pBuffer);
 
+  // pooled buffers for ReceiveData, see AudioBufferPool
+  AudioBufferPool& BufferPool() { return buffer_pool_; }
+
   void SetEnded(bool ended);
 
+  // makes a ReadData waiting for audio, and the ones after it, return the
+  // samples read so far as SpkrContinue instead of waiting, until ResumeRead.
+  // May be called from any thread; no audio is lost
+  void CancelRead();
+  void ResumeRead() { read_cancelled_ = false; }
+  bool ReadCancelled() const { return read_cancelled_; }
+
+  bool Ended() const { return ended_; }
+
+  // true if ReadData of num_samples would return without waiting for more data
+  bool DataReady(int32 num_samples) const { return ended_ || num_samples_ready_ >= num_samples; }
+
+  // samples queued and not read yet, and all samples ever queued; both can
+  // be read from any thread
+  int32 NumSamplesReady() const { return num_samples_ready_; }
+  int64 NumSamplesReceived() const { return num_samples_received_; }
+
   ~AudioBufferSource();
 
  private:
@@ -58,12 +149,24 @@ class AudioBufferSource {
   // get g buffer from the queue, if the queue is empty and is not ended, wait until a buffer is available
   AudioBuffer* DequeueBuffer();
 
-  bool ended_;
+  // about a minute of 10 ms packets; a producer that fills it waits for the decoder
+  static const size_t kBufferRingCapacity = 8192;
+
+  std::atomic<bool> ended_;
+  std::atomic<bool> read_cancelled_;
+  AudioBufferPool buffer_pool_;
+  // makes the producers of buffer_ring_ one at a time
+  std::mutex producer_mtx_;
+  SpscRing<AudioBuffer*> buffer_ring_;
+  // the mutex and condition are only used when the reader finds the ring empty
+  std::atomic<bool> consumer_waiting_;
   std::mutex buffer_mtx_;
   std::condition_variable buffer_cond_;
   AudioBuffer* cur_buffer_;
   kaldi::int32 pos_in_current_buf_;
-  std::queue<AudioBuffer* > data_buffer_queue_;
+  // samples received and not yet read
+  std::atomic<kaldi::int32> num_samples_ready_;
+  std::atomic<kaldi::int64> num_samples_received_;
   KALDI_DISALLOW_COPY_AND_ASSIGN(AudioBufferSource);
 };
 
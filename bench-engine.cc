@@ -0,0 +1,261 @@
+// 张; 杨
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "feat/wave-reader.h"
+#include "onlinedecoder/speech-recognition-engine.h"
+
+#include <sys/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace kaldi;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Utterance {
+  std::string key;
+  std::vector<short> samples;
+  BaseFloat samp_freq;
+};
+
+// timestamps of the utterance a recognizer is decoding, filled in by the
+// callbacks
+struct UtteranceTiming {
+  Clock::time_point first_audio;
+  Clock::time_point last_audio;
+  Clock::time_point first_partial;
+  Clock::time_point last_final;
+  bool has_partial;
+  // set with last_audio; finals before it are of earlier segments
+  bool audio_ended;
+  bool has_final;
+  UtteranceTiming(): has_partial(false), audio_ended(false), has_final(false) {}
+};
+
+static std::mutex g_timing_mtx;
+static std::map<int, UtteranceTiming*> g_timings;
+
+static UtteranceTiming *FindTiming(int id) {
+  std::map<int, UtteranceTiming*>::iterator it = g_timings.find(id);
+  return it == g_timings.end() ? NULL : it->second;
+}
+
+static void OnPartialResult(int id, const char *results) {
+  Clock::time_point now = Clock::now();
+  std::lock_guard<std::mutex> timing_locker(g_timing_mtx);
+  UtteranceTiming *timing = FindTiming(id);
+  if (timing != NULL && !timing->has_partial) {
+    timing->first_partial = now;
+    timing->has_partial = true;
+  }
+}
+
+static void OnFinalResult(int id, const char *results) {
+  Clock::time_point now = Clock::now();
+  std::lock_guard<std::mutex> timing_locker(g_timing_mtx);
+  UtteranceTiming *timing = FindTiming(id);
+  if (timing != NULL && timing->audio_ended) {
+    // an utterance can have several segments, the last one counts
+    timing->last_final = now;
+    timing->has_final = true;
+  }
+}
+
+static double Seconds(Clock::duration d) {
+  return std::chrono::duration<double>(d).count();
+}
+
+static double Percentile(std::vector<double> values, double p) {
+  if (values.empty())
+    return 0.0;
+  std::sort(values.begin(), values.end());
+  size_t i = std::min(values.size() - 1, static_cast<size_t>(p * values.size()));
+  return values[i];
+}
+
+struct BenchOptions {
+  std::string config;
+  int32 num_streams;
+  BaseFloat packet_secs;
+  bool real_time;
+};
+
+struct StreamResults {
+  std::vector<double> final_latencies;
+  std::vector<double> partial_latencies;
+  double audio_secs;
+  int32 num_failed;
+  // decoded recordings whose last final result came before their last audio
+  int32 num_no_final;
+  StreamResults(): audio_secs(0.0), num_failed(0), num_no_final(0) {}
+};
+
+// decode utterances taken from the shared list until it is empty, with a
+// new recognizer per utterance
+static void RunStream(const BenchOptions &opts, const std::vector<Utterance> &utterances,
+                      std::atomic<size_t> *next_utterance, StreamResults *results) {
+  while (true) {
+    size_t u = next_utterance->fetch_add(1);
+    if (u >= utterances.size())
+      break;
+    const Utterance &utt = utterances[u];
+    int id = CreateRecognizer(opts.config.c_str());
+    if (id < 0) {
+      KALDI_WARN << "Failed to create a recognizer: " << GetLastErrMsg();
+      results->num_failed++;
+      continue;
+    }
+    UtteranceTiming timing;
+    {
+      std::lock_guard<std::mutex> timing_locker(g_timing_mtx);
+      g_timings[id] = &timing;
+    }
+    AddCallback(id, PARTIAL_RESULT_SIGNAL, OnPartialResult);
+    AddCallback(id, FINAL_RESULT_SIGNAL, OnFinalResult);
+    if (StartRecognizer(id) != SUCCEED) {
+      KALDI_WARN << "Failed to start a recognizer: " << GetLastErrMsg();
+      results->num_failed++;
+    } else {
+      int32 packet_size = std::max<int32>(1, static_cast<int32>(opts.packet_secs * utt.samp_freq));
+      int32 num_samples = utt.samples.size();
+      timing.first_audio = Clock::now();
+      for (int32 offset = 0; offset < num_samples; offset += packet_size) {
+        if (opts.real_time) {
+          // don't send audio before it would have been spoken
+          Clock::time_point due = timing.first_audio + std::chrono::duration_cast<Clock::duration>(
+              std::chrono::duration<double>(offset / utt.samp_freq));
+          std::this_thread::sleep_until(due);
+        }
+        int32 size = std::min(packet_size, num_samples - offset);
+        AddBuffer(id, "bench", &(utt.samples[offset]), size);
+      }
+      {
+        std::lock_guard<std::mutex> timing_locker(g_timing_mtx);
+        timing.last_audio = Clock::now();
+        timing.audio_ended = true;
+      }
+      StopRecognizer(id);
+      WaitForRecogStop(id);
+
+      std::lock_guard<std::mutex> timing_locker(g_timing_mtx);
+      results->audio_secs += num_samples / utt.samp_freq;
+      if (timing.has_final)
+        results->final_latencies.push_back(Seconds(timing.last_final - timing.last_audio));
+      else
+        results->num_no_final++;
+      if (timing.has_partial)
+        results->partial_latencies.push_back(Seconds(timing.first_partial - timing.first_audio));
+    }
+    {
+      std::lock_guard<std::mutex> timing_locker(g_timing_mtx);
+      g_timings.erase(id);
+    }
+    FreeRecognizer(id);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  try {
+    const char *usage =
+        "Decode a list of recordings on concurrent recognizers through the C API\n"
+        "and report the real time factor, CPU time, peak memory and latencies.\n"
+        "Each stream creates a recognizer per recording, so the latencies include\n"
+        "no time spent waiting for a free stream.\n"
+        "\n"
+        "Usage: bench-engine [options] <config> <wav-rspecifier>\n"
+        "e.g.: bench-engine --num-streams=16 --real-time=true decoder.conf scp:wav.scp\n";
+    ParseOptions po(usage);
+    BenchOptions opts;
+    opts.num_streams = 1;
+    opts.packet_secs = 0.1;
+    opts.real_time = false;
+    po.Register("num-streams", &opts.num_streams, "Number of recognizers decoding at the same time");
+    po.Register("packet-secs", &opts.packet_secs, "Audio per AddBuffer call, in seconds");
+    po.Register("real-time", &opts.real_time, "If true, send the audio of each stream no "
+                "faster than real time, otherwise as fast as AddBuffer takes it");
+    po.Read(argc, argv);
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      return 1;
+    }
+    opts.config = po.GetArg(1);
+    std::string wav_rspecifier = po.GetArg(2);
+
+    // read everything first, so reading doesn't count in the timings
+    std::vector<Utterance> utterances;
+    SequentialTableReader<WaveHolder> wav_reader(wav_rspecifier);
+    for (; !wav_reader.Done(); wav_reader.Next()) {
+      const WaveData &wave_data = wav_reader.Value();
+      Utterance utt;
+      utt.key = wav_reader.Key();
+      utt.samp_freq = wave_data.SampFreq();
+      SubVector<BaseFloat> channel(wave_data.Data(), 0);
+      utt.samples.resize(channel.Dim());
+      for (int32 i = 0; i < channel.Dim(); i++)
+        utt.samples[i] = static_cast<short>(channel(i));
+      utterances.push_back(utt);
+    }
+    if (utterances.empty())
+      KALDI_ERR << "No recordings in " << wav_rspecifier;
+
+    std::atomic<size_t> next_utterance(0);
+    std::vector<StreamResults> results(opts.num_streams);
+    std::vector<std::thread*> streams;
+    Clock::time_point start = Clock::now();
+    for (int32 s = 0; s < opts.num_streams; s++)
+      streams.push_back(new std::thread(RunStream, std::cref(opts), std::cref(utterances),
+                                        &next_utterance, &(results[s])));
+    for (size_t s = 0; s < streams.size(); s++) {
+      streams[s]->join();
+      delete streams[s];
+    }
+    double wall_secs = Seconds(Clock::now() - start);
+
+    StreamResults total;
+    for (size_t s = 0; s < results.size(); s++) {
+      total.audio_secs += results[s].audio_secs;
+      total.num_failed += results[s].num_failed;
+      total.num_no_final += results[s].num_no_final;
+      total.final_latencies.insert(total.final_latencies.end(),
+                                   results[s].final_latencies.begin(),
+                                   results[s].final_latencies.end());
+      total.partial_latencies.insert(total.partial_latencies.end(),
+                                     results[s].partial_latencies.begin(),
+                                     results[s].partial_latencies.end());
+    }
+
+    struct rusage usage_self;
+    getrusage(RUSAGE_SELF, &usage_self);
+    double cpu_secs = usage_self.ru_utime.tv_sec + usage_self.ru_utime.tv_usec * 1.0e-6 +
+                      usage_self.ru_stime.tv_sec + usage_self.ru_stime.tv_usec * 1.0e-6;
+
+    KALDI_LOG << "Decoded " << utterances.size() - total.num_failed << " of "
+              << utterances.size() << " recordings, " << total.audio_secs
+              << " seconds of audio, on " << opts.num_streams << " streams in "
+              << wall_secs << " seconds";
+    if (total.audio_secs > 0) {
+      KALDI_LOG << "Aggregate real time factor " << wall_secs / total.audio_secs
+                << " (" << total.audio_secs / wall_secs << " audio seconds per second)";
+      KALDI_LOG << "CPU seconds per audio second " << cpu_secs / total.audio_secs;
+    }
+    KALDI_LOG << "Peak RSS " << usage_self.ru_maxrss / 1024.0 << " MB";
+    KALDI_LOG << "Last audio to final result, " << total.final_latencies.size()
+              << " recordings: p50 " << Percentile(total.final_latencies, 0.50)
+              << " p95 " << Percentile(total.final_latencies, 0.95)
+              << " p99 " << Percentile(total.final_latencies, 0.99) << " seconds, "
+              << total.num_no_final << " recordings with no final result after the last audio";
+    KALDI_LOG << "First audio to first partial result, " << total.partial_latencies.size()
+              << " recordings: p50 " << Percentile(total.partial_latencies, 0.50)
+              << " p95 " << Percentile(total.partial_latencies, 0.95)
+              << " p99 " << Percentile(total.partial_latencies, 0.99) << " seconds";
+    return total.num_failed == 0 ? 0 : 1;
+  } catch (const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -0,0 +1,483 @@
+// 张; 杨
+#include "onlinedecoder/decoder-model.h"
+#include "fst/script/project.h"
+
+#include <atomic>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sstream>
+#include <vector>
+
+namespace kaldi {
+
+// resolve plain file names so that different spellings of the same path
+// share a model; rspecifiers that are not files are kept as they are
+static std::string ResolvePath(const std::string &filename) {
+	if (filename.empty())
+		return filename;
+	char resolved[PATH_MAX];
+	if (realpath(filename.c_str(), resolved) == NULL)
+		return filename;
+	return std::string(resolved);
+}
+
+std::string DecoderModelConfig::Key() const {
+	std::ostringstream key;
+	key << ResolvePath(model_rspecifier_) << '|'
+	    << ResolvePath(fst_rspecifier_) << '|'
+	    << ResolvePath(lm_fst_rspecifier_) << '|'
+	    << ResolvePath(big_lm_const_arpa_rspecifier_) << '|'
+	    << ResolvePath(word_syms_filename_) << '|'
+	    << ResolvePath(phone_syms_filename_) << '|'
+	    << ResolvePath(word_boundary_info_filename_) << '|'
+	    << map_fst_ << '|'
+	    << cache_looped_computation_ << '|'
+	    << batch_nnet_ << '|'
+	    << batch_size_ << '|'
+	    << batch_max_wait_ms_ << '|'
+	    << batch_extra_left_context_ << '|'
+	    << decodable_opts_.extra_left_context_initial << '|'
+	    << decodable_opts_.frame_subsampling_factor << '|'
+	    << decodable_opts_.frames_per_chunk << '|'
+	    << decodable_opts_.acoustic_scale << '|'
+	    << decodable_opts_.compute_config.debug << '|';
+	decodable_opts_.optimize_config.Write(key, false);
+	return key.str();
+}
+
+DecoderModel::DecoderModel() {
+	this->trans_model_ = NULL;
+	this->am_nnet3_ = NULL;
+	this->looped_info_ = NULL;
+	this->nnet_batch_scheduler_ = NULL;
+	this->decode_fst_ = NULL;
+	this->lm_fst_ = NULL;
+	this->big_lm_ = NULL;
+	this->lm_compose_cache_ = NULL;
+	this->word_syms_ = NULL;
+	this->phone_syms_ = NULL;
+	this->word_boundary_info_ = NULL;
+}
+
+// Reference: gst_kaldinnet2onlinedecoder_allocate
+void DecoderModel::Load(const DecoderModelConfig &config) {
+	KALDI_VLOG(2) << "Loading Kaldi models";
+
+	// every recognizer decodes with these
+	if (config.model_rspecifier_.empty() || config.fst_rspecifier_.empty())
+		KALDI_ERR << "Both --model and --fst must be set";
+
+	if (!config.word_syms_filename_.empty()) {
+		this->LoadWordSyms(config);
+	}
+
+	if (!config.phone_syms_filename_.empty()) {
+		this->LoadPhoneSyms(config);
+	}
+
+	if (!config.word_boundary_info_filename_.empty()) {
+		this->LoadWordBoundaryInfo(config);
+	}
+
+	if (!config.model_rspecifier_.empty()) {
+		this->LoadAcousticModel(config);
+	}
+
+	if (!config.fst_rspecifier_.empty()) {
+		if (config.map_fst_) {
+			this->LoadMappedFst(config);
+		} else {
+			this->LoadFst(config);
+		}
+	}
+
+	if (!config.lm_fst_rspecifier_.empty()) {
+		this->LoadLmFst(config);
+	}
+
+	if (!config.big_lm_const_arpa_rspecifier_.empty()) {
+		this->LoadBigLm(config);
+	}
+}
+
+// load word syms
+// Reference: gst_kaldinnet2onlinedecoder_load_word_syms
+void DecoderModel::LoadWordSyms(const DecoderModelConfig &config)
+{
+  try {
+	  fst::SymbolTable * new_word_syms = fst::SymbolTable::ReadText(config.word_syms_filename_);
+	  if (!new_word_syms) {
+		  throw std::runtime_error("Word symbol table not read.");
+	  }
+
+	  this->word_syms_ = new_word_syms;
+	} catch (std::runtime_error& e) {
+	  KALDI_ERR << "Error loading the word symbol table: " << config.word_syms_filename_;
+	}
+}
+
+// load phone syms
+// Reference: gst_kaldinnet2onlinedecoder_load_phone_syms
+void DecoderModel::LoadPhoneSyms(const DecoderModelConfig &config)
+{
+  try {
+	  fst::SymbolTable * new_phone_syms = fst::SymbolTable::ReadText(config.phone_syms_filename_);
+	  if (!new_phone_syms) {
+		  throw std::runtime_error("Phone symbol table not read.");
+	  }
+
+	  this->phone_syms_ = new_phone_syms;
+	} catch (std::runtime_error& e) {
+	  KALDI_ERR << "Error loading the phone symbol table: " << config.phone_syms_filename_;
+	}
+}
+
+// load word boundary info
+// Reference: gst_kaldinnet2onlinedecoder_load_word_boundary_info
+void DecoderModel::LoadWordBoundaryInfo(const DecoderModelConfig &config)
+{
+  try {
+	  WordBoundaryInfoNewOpts opts; // use default opts
+	  this->word_boundary_info_ = new WordBoundaryInfo(opts, config.word_boundary_info_filename_);
+  } catch (std::runtime_error& e) {
+	  KALDI_ERR << "Error loading the word boundary info: " << config.word_boundary_info_filename_;
+	}
+}
+
+// load acoustic model
+// Reference: gst_kaldinnet2onlinedecoder_load_model
+void DecoderModel::LoadAcousticModel(const DecoderModelConfig &config)
+{
+	this->trans_model_ = new TransitionModel();
+	this->am_nnet3_ = new nnet3::AmNnetSimple();
+
+  // Make the objects read the new models
+  try {
+    bool binary;
+	  Input ki(config.model_rspecifier_, &binary);
+	  this->trans_model_->Read(ki.Stream(), binary);
+
+	  this->am_nnet3_->Read(ki.Stream(), binary);
+	  SetBatchnormTestMode(true, &(this->am_nnet3_->GetNnet()));
+	  SetDropoutTestMode(true, &(this->am_nnet3_->GetNnet()));
+	  if (config.batch_nnet_) {
+	    this->CreateBatchScheduler(config);
+	  } else {
+	    // this object contains precomputed stuff that is used by all decodable
+	    // objects.  It takes a pointer to am_nnet because if it has iVectors it has
+	    // to modify the nnet to accept iVectors at intervals.
+	    this->LoadLoopedInfo(config);
+	  }
+	} catch (std::runtime_error& e) {
+	  KALDI_ERR << "Error loading the acoustic model: " << config.model_rspecifier_;
+	}
+}
+
+// the batch computer evaluates fixed-size chunks with explicit context, so it
+// uses the unmodified nnet rather than the looped info, which changes the nnet
+// to read iVectors at intervals
+void DecoderModel::CreateBatchScheduler(const DecoderModelConfig &config)
+{
+	nnet3::NnetBatchComputerOptions batch_opts;
+	batch_opts.acoustic_scale = config.decodable_opts_.acoustic_scale;
+	batch_opts.frame_subsampling_factor = config.decodable_opts_.frame_subsampling_factor;
+	batch_opts.debug_computation = config.decodable_opts_.debug_computation;
+	batch_opts.optimize_config = config.decodable_opts_.optimize_config;
+	batch_opts.compute_config = config.decodable_opts_.compute_config;
+	batch_opts.extra_left_context = config.batch_extra_left_context_;
+	batch_opts.minibatch_size = config.batch_size_;
+	// chunks must hold a whole number of output frames
+	int32 sf = batch_opts.frame_subsampling_factor;
+	batch_opts.frames_per_chunk = sf * ((config.decodable_opts_.frames_per_chunk + sf - 1) / sf);
+
+	this->nnet_batch_scheduler_ = new NnetBatchScheduler(batch_opts,
+		this->am_nnet3_->GetNnet(), this->am_nnet3_->Priors(), config.batch_max_wait_ms_);
+}
+
+// FNV-1a hash of a file's bytes, 0 if it can't be read
+static uint64 HashFile(const std::string &filename) {
+	std::ifstream strm(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+	if (!strm)
+		return 0;
+	uint64 hash = 14695981039346656037ULL;
+	std::vector<char> block(1 << 16);
+	while (strm) {
+		strm.read(&(block[0]), block.size());
+		for (std::streamsize i = 0; i < strm.gcount(); i++) {
+			hash ^= static_cast<unsigned char>(block[i]);
+			hash *= 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+// the part of the cache header that must match for the cache to be used: a
+// hash of the model file, so that a changed model is compiled again, and the
+// options the computation is compiled with
+static void WriteLoopedCacheHeader(std::ostream &os, uint64 model_hash,
+                                   const nnet3::NnetSimpleLoopedComputationOptions &opts) {
+	WriteToken(os, true, "<ModelHash>");
+	WriteBasicType(os, true, model_hash);
+	WriteToken(os, true, "<OptimizeConfig>");
+	opts.optimize_config.Write(os, true);
+	WriteToken(os, true, "<ComputeDebug>");
+	WriteBasicType(os, true, opts.compute_config.debug);
+}
+
+// compile the looped computation, or with cache_looped_computation_ read it
+// from <model>.looped-<frames per chunk>-<subsampling>-<initial left context>,
+// whose header must match WriteLoopedCacheHeader; the cache is rewritten
+// whenever it was not usable, through a temporary file renamed into place so
+// that other processes never read a partly written cache
+void DecoderModel::LoadLoopedInfo(const DecoderModelConfig &config)
+{
+	const nnet3::NnetSimpleLoopedComputationOptions &opts = config.decodable_opts_;
+	if (!config.cache_looped_computation_ ||
+	    ClassifyRxfilename(config.model_rspecifier_) != kFileInput) {
+		this->looped_info_ = new LoopedComputationInfo(opts, this->am_nnet3_);
+		return;
+	}
+
+	std::ostringstream cache_filename;
+	cache_filename << config.model_rspecifier_ << ".looped-" << opts.frames_per_chunk << '-'
+	               << opts.frame_subsampling_factor << '-' << opts.extra_left_context_initial;
+	uint64 model_hash = HashFile(config.model_rspecifier_);
+	std::ostringstream header;
+	WriteLoopedCacheHeader(header, model_hash, opts);
+
+	if (std::ifstream(cache_filename.str().c_str())) {
+		try {
+			bool binary;
+			Input ki(cache_filename.str(), &binary);
+			std::string cached_header(header.str().size(), '\0');
+			ki.Stream().read(&(cached_header[0]), cached_header.size());
+			if (binary && ki.Stream() && cached_header == header.str()) {
+				this->looped_info_ = new LoopedComputationInfo(opts, this->am_nnet3_,
+				                                               ki.Stream(), binary);
+				KALDI_VLOG(2) << "Read looped computation from " << cache_filename.str();
+				return;
+			}
+			KALDI_LOG << "Model or options changed since " << cache_filename.str()
+			          << " was written, recompiling";
+		} catch (std::runtime_error& e) {
+			KALDI_WARN << "Error reading looped computation " << cache_filename.str()
+			           << ", recompiling";
+		}
+	}
+
+	this->looped_info_ = new LoopedComputationInfo(opts, this->am_nnet3_);
+	// unique per process and per load, models sharing a cache can load at once
+	static std::atomic<int32> num_cache_writes(0);
+	std::ostringstream tmp_filename;
+	tmp_filename << cache_filename.str() << ".tmp." << getpid() << '.' << num_cache_writes++;
+	bool written = false;
+	try {
+		Output ko(tmp_filename.str(), true);
+		ko.Stream() << header.str();
+		this->looped_info_->Write(ko.Stream(), true);
+		written = ko.Close();
+	} catch (std::runtime_error& e) {
+		// reported below
+	}
+	if (!written || rename(tmp_filename.str().c_str(), cache_filename.str().c_str()) != 0) {
+		KALDI_WARN << "Error writing looped computation " << cache_filename.str();
+		unlink(tmp_filename.str().c_str());
+	}
+}
+
+// load fst
+// Reference: gst_kaldinnet2onlinedecoder_load_fst
+void DecoderModel::LoadFst(const DecoderModelConfig &config)
+{
+  try {
+	  fst::Fst<fst::StdArc> * new_decode_fst = fst::ReadFstKaldiGeneric(config.fst_rspecifier_);
+
+    if (!new_decode_fst) {
+	    throw std::runtime_error("FST decoding graph not read.");
+	  }
+
+	  this->decode_fst_ = new_decode_fst;
+	} catch (std::runtime_error& e) {
+	  KALDI_ERR << "Error loading FST decoding graph: " << config.fst_rspecifier_;
+	}
+}
+
+// memory-map a const fst written with
+//   fstconvert --fst_type=const --fst_align HCLG.fst HCLG.const.fst
+// the pages are shared through the page cache by all decoder processes on the
+// host, and startup only pays for the page faults of the states visited.
+// Graphs of other types, or unaligned ones, are read into memory by OpenFst.
+void DecoderModel::LoadMappedFst(const DecoderModelConfig &config)
+{
+	std::ifstream strm(config.fst_rspecifier_.c_str(),
+	                   std::ios_base::in | std::ios_base::binary);
+	if (!strm) {
+		KALDI_WARN << "Could not open " << config.fst_rspecifier_
+		           << " for mapping, reading it instead";
+		this->LoadFst(config);
+		return;
+	}
+	fst::FstReadOptions read_opts(config.fst_rspecifier_);
+	read_opts.mode = fst::FstReadOptions::MAP;
+	fst::Fst<fst::StdArc> *new_decode_fst = fst::Fst<fst::StdArc>::Read(strm, read_opts);
+	if (!new_decode_fst) {
+		KALDI_WARN << "Error mapping FST decoding graph: " << config.fst_rspecifier_
+		           << ", reading it instead";
+		this->LoadFst(config);
+		return;
+	}
+	if (new_decode_fst->Type() != "const") {
+		KALDI_WARN << "FST decoding graph " << config.fst_rspecifier_ << " is of type "
+		           << new_decode_fst->Type() << ", it was read into memory instead of "
+		           << "being mapped; convert it with fstconvert --fst_type=const --fst_align";
+	}
+	this->decode_fst_ = new_decode_fst;
+}
+
+// load the LM fst and create the compose cache shared by the recognizers
+// Reference: gst_kaldinnet2onlinedecoder_load_lm_fst
+void DecoderModel::LoadLmFst(const DecoderModelConfig &config) {
+  try {
+    fst::VectorFst<fst::StdArc> *std_lm_fst = fst::VectorFst<fst::StdArc>::Read(config.lm_fst_rspecifier_);
+    if (!std_lm_fst) {
+	    throw std::runtime_error("LM FST not read.");
+	  }
+    fst::Project(std_lm_fst, fst::PROJECT_OUTPUT);
+
+    if (std_lm_fst->Properties(fst::kILabelSorted, true) == 0) {
+      // Make sure LM is sorted on ilabel.
+      fst::ILabelCompare<fst::StdArc> ilabel_comp;
+      fst::ArcSort(std_lm_fst, ilabel_comp);
+    }
+    // the lattice weights put all of the cost on the graph part
+    fst::StdToLatticeMapper<BaseFloat> mapper;
+    this->lm_fst_ = new fst::VectorFst<LatticeArc>();
+    fst::ArcMap(*std_lm_fst, this->lm_fst_, mapper);
+    delete std_lm_fst;
+
+    // Change the options for TableCompose to match the input
+    // (because it's the arcs of the LM FST we want to do lookup
+    // on).
+    fst::TableComposeOptions compose_opts(fst::TableMatcherOptions(),
+                                          true, fst::SEQUENCE_FILTER,
+                                          fst::MATCH_INPUT);
+    // The following is an optimization for the TableCompose
+    // composition: it stores certain tables that enable fast
+    // lookup of arcs during composition.
+    this->lm_compose_cache_ = new fst::TableComposeCache<fst::Fst<LatticeArc> >(compose_opts);
+	} catch (std::runtime_error& e) {
+	  KALDI_ERR << "Error loading LM FST decoding graph: " << config.lm_fst_rspecifier_;
+	}
+}
+
+void DecoderModel::ComposeLmFst(const Lattice &lat, Lattice *composed_lat) const {
+	KALDI_ASSERT(this->lm_fst_ != NULL && this->lm_compose_cache_ != NULL);
+	std::lock_guard<std::mutex> lm_compose_locker(this->lm_compose_mtx_);
+	fst::TableCompose(lat, *(this->lm_fst_), composed_lat, this->lm_compose_cache_);
+}
+
+// load the big LM in ConstArpaLm format, as written by arpa-to-const-arpa
+// Reference: gst_kaldinnet2onlinedecoder_load_big_lm
+void DecoderModel::LoadBigLm(const DecoderModelConfig &config) {
+  ConstArpaLm *new_big_lm = new ConstArpaLm();
+  try {
+    ReadKaldiObject(config.big_lm_const_arpa_rspecifier_, new_big_lm);
+    this->big_lm_ = new_big_lm;
+  } catch (std::runtime_error& e) {
+    delete new_big_lm;
+    KALDI_ERR << "Error loading the big LM: " << config.big_lm_const_arpa_rspecifier_;
+  }
+}
+
+DecoderModel::~DecoderModel() {
+	// stop the compute thread before the nnet it reads goes away
+	if (this->nnet_batch_scheduler_) {
+		delete this->nnet_batch_scheduler_;
+	}
+	if (this->looped_info_) {
+		delete this->looped_info_;
+	}
+	if (this->am_nnet3_) {
+		delete this->am_nnet3_;
+	}
+	if (this->trans_model_) {
+		delete this->trans_model_;
+	}
+	if (this->decode_fst_) {
+		delete this->decode_fst_;
+	}
+	if (this->lm_compose_cache_) {
+		delete this->lm_compose_cache_;
+	}
+	if (this->lm_fst_) {
+		delete this->lm_fst_;
+	}
+	if (this->big_lm_) {
+		delete this->big_lm_;
+	}
+	if (this->word_syms_) {
+		delete this->word_syms_;
+	}
+	if (this->phone_syms_) {
+		delete this->phone_syms_;
+	}
+	if (this->word_boundary_info_) {
+		delete this->word_boundary_info_;
+	}
+}
+
+DecoderModelRegistry &DecoderModelRegistry::Instance() {
+	static DecoderModelRegistry registry;
+	return registry;
+}
+
+std::shared_ptr<const DecoderModel> DecoderModelRegistry::Acquire(
+	const DecoderModelConfig &config) {
+	std::string key = config.Key();
+	std::unique_lock<std::mutex> registry_locker(registry_mtx_);
+
+	while (true) {
+		std::map<std::string, ModelEntry>::iterator it = models_.find(key);
+		if (it == models_.end())
+			break;
+		if (it->second.loading_) {
+			// another recognizer is loading this model, wait for it
+			registry_cond_.wait(registry_locker);
+			continue;
+		}
+		std::shared_ptr<const DecoderModel> model = it->second.model_.lock();
+		if (model) {
+			KALDI_VLOG(2) << "Sharing loaded model " << key;
+			return model;
+		}
+		models_.erase(it);
+		break;
+	}
+
+	// load without the lock, so that recognizers of other models are not
+	// held up by it
+	models_[key].loading_ = true;
+	registry_locker.unlock();
+	std::shared_ptr<DecoderModel> new_model(new DecoderModel());
+	try {
+		new_model->Load(config);
+	} catch (...) {
+		// a model that failed to load is never shared; recognizers waiting for
+		// it try to load it themselves
+		registry_locker.lock();
+		models_.erase(key);
+		registry_cond_.notify_all();
+		throw;
+	}
+	registry_locker.lock();
+	ModelEntry &entry = models_[key];
+	entry.model_ = new_model;
+	entry.loading_ = false;
+	registry_cond_.notify_all();
+	return new_model;
+}
+
+}
@@ -0,0 +1,142 @@
+// 张; 杨
+#ifndef KALDI_DECODER_MODEL_H_
+#define KALDI_DECODER_MODEL_H_
+
+#include "online2/online-nnet3-decoding.h"
+#include "fstext/fstext-lib.h"
+#include "nnet3/nnet-utils.h"
+#include "lat/word-align-lattice.h"
+#include "lm/const-arpa-lm.h"
+#include "onlinedecoder/online-nnet3-batch-decoding.h"
+#include "onlinedecoder/online-nnet3-looped-decoding.h"
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace kaldi {
+
+/// DecoderModelConfig holds everything that identifies a loaded model bundle.
+/// Recognizers whose configs produce the same Key() share one DecoderModel.
+struct DecoderModelConfig {
+	std::string model_rspecifier_;
+	std::string fst_rspecifier_;
+	std::string lm_fst_rspecifier_;
+	std::string big_lm_const_arpa_rspecifier_;
+	std::string word_syms_filename_;
+	std::string phone_syms_filename_;
+	std::string word_boundary_info_filename_;
+
+	// memory-map the HCLG instead of reading it onto the heap
+	bool map_fst_;
+
+	// keep the compiled looped computation in a file next to the model
+	bool cache_looped_computation_;
+
+	// evaluate the acoustic model in minibatches shared by all recognizers
+	bool batch_nnet_;
+	int32 batch_size_;
+	int32 batch_max_wait_ms_;
+	int32 batch_extra_left_context_;
+
+	// the looped computation is compiled with these, so they are part of the key
+	nnet3::NnetSimpleLoopedComputationOptions decodable_opts_;
+
+	DecoderModelConfig(): map_fst_(false), cache_looped_computation_(false),
+	                      batch_nnet_(false), batch_size_(32),
+	                      batch_max_wait_ms_(10), batch_extra_left_context_(0) {}
+
+	// registry key built from the resolved file names and the decodable options
+	std::string Key() const;
+};
+
+/// DecoderModel is the read-only part of a recognizer: acoustic model, decoding
+/// graph, symbol tables and word boundary info. It is loaded once per distinct
+/// DecoderModelConfig and shared by all recognizers using it, so nothing here
+/// may be modified after Load() returns (the batch scheduler and the LM
+/// compose cache do their own locking).
+struct DecoderModel {
+	TransitionModel *trans_model_;
+	nnet3::AmNnetSimple *am_nnet3_;
+	// exactly one of these is set: the looped computation info used by each
+	// recognizer's own decodable, or the shared batch scheduler
+	LoopedComputationInfo *looped_info_;
+	NnetBatchScheduler *nnet_batch_scheduler_;
+	fst::Fst<fst::StdArc> *decode_fst_;
+
+	// G.fst projected on the output side, sorted on ilabel and converted to
+	// lattice arcs, whose scores are removed from the lattice when rescoring;
+	// it is converted once here instead of through a caching MapFst in every
+	// recognizer
+	fst::VectorFst<LatticeArc> *lm_fst_;
+	// the big LM whose scores are added instead
+	ConstArpaLm *big_lm_;
+	// the arc lookup tables of lm_fst_ for TableCompose, built once and used
+	// by all recognizers under lm_compose_mtx_: a TableMatcher keeps its
+	// iteration state in the tables it shares with its copies, so two
+	// compositions can't use them at the same time
+	fst::TableComposeCache<fst::Fst<LatticeArc> > *lm_compose_cache_;
+	mutable std::mutex lm_compose_mtx_;
+
+	fst::SymbolTable *word_syms_;
+	fst::SymbolTable *phone_syms_;
+	WordBoundaryInfo *word_boundary_info_;
+
+	DecoderModel();
+	~DecoderModel();
+
+	// throws if a file of config can't be read
+	void Load(const DecoderModelConfig &config);
+
+	// compose lat with lm_fst_; only the composition itself holds the lock,
+	// as TableCompose expands it into composed_lat before returning
+	void ComposeLmFst(const Lattice &lat, Lattice *composed_lat) const;
+
+ private:
+	void LoadWordSyms(const DecoderModelConfig &config);
+	void LoadPhoneSyms(const DecoderModelConfig &config);
+	void LoadWordBoundaryInfo(const DecoderModelConfig &config);
+	void LoadAcousticModel(const DecoderModelConfig &config);
+	void CreateBatchScheduler(const DecoderModelConfig &config);
+	void LoadLoopedInfo(const DecoderModelConfig &config);
+	void LoadFst(const DecoderModelConfig &config);
+	void LoadMappedFst(const DecoderModelConfig &config);
+	void LoadLmFst(const DecoderModelConfig &config);
+	void LoadBigLm(const DecoderModelConfig &config);
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(DecoderModel);
+};
+
+/// Process-wide registry of loaded models. A model stays loaded as long as
+/// at least one recognizer holds the pointer returned by Acquire.
+class DecoderModelRegistry {
+ public:
+	static DecoderModelRegistry &Instance();
+
+	// return the shared model for config, loading it if no recognizer holds
+	// it; throws if it can't be loaded
+	std::shared_ptr<const DecoderModel> Acquire(const DecoderModelConfig &config);
+
+ private:
+	DecoderModelRegistry() {}
+
+	// a model is loaded without holding registry_mtx_; while it loads its
+	// entry is marked loading_, and recognizers asking for the same model
+	// wait on registry_cond_ instead of loading it again
+	struct ModelEntry {
+		std::weak_ptr<const DecoderModel> model_;
+		bool loading_;
+		ModelEntry(): loading_(false) {}
+	};
+	std::mutex registry_mtx_;
+	std::condition_variable registry_cond_;
+	std::map<std::string, ModelEntry> models_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(DecoderModelRegistry);
+};
+
+}
+
+#endif  // KALDI_DECODER_MODEL_H_
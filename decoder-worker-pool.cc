@@ -0,0 +1,92 @@
+// 张; 杨
+#include "onlinedecoder/decoder-worker-pool.h"
+
+namespace kaldi {
+
+// index of the pool worker running on this thread, -1 for other threads
+static thread_local int32 current_worker_index = -1;
+
+DecoderWorkerPool &DecoderWorkerPool::Instance(int32 num_workers) {
+	static DecoderWorkerPool pool(num_workers);
+	return pool;
+}
+
+DecoderWorkerPool::DecoderWorkerPool(int32 num_workers):
+	num_queued_(0), next_queue_(0), finished_(false) {
+	if (num_workers <= 0)
+		num_workers = std::max<int32>(1, std::thread::hardware_concurrency());
+	KALDI_VLOG(2) << "Starting " << num_workers << " decoding workers";
+	for (int32 i = 0; i < num_workers; i++)
+		queues_.push_back(new TaskQueue());
+	for (int32 i = 0; i < num_workers; i++)
+		workers_.push_back(new std::thread(&DecoderWorkerPool::WorkerLoop, this, i));
+}
+
+void DecoderWorkerPool::Submit(const std::function<void()> &task) {
+	int32 queue_index = current_worker_index;
+	if (queue_index < 0)
+		queue_index = next_queue_.fetch_add(1) % queues_.size();
+	{
+		std::lock_guard<std::mutex> queue_locker(queues_[queue_index]->queue_mtx_);
+		queues_[queue_index]->tasks_.push_back(task);
+	}
+	num_queued_.fetch_add(1);
+	// take the sleep lock so a worker between its check and its wait can't miss this
+	std::lock_guard<std::mutex> sleep_locker(sleep_mtx_);
+	sleep_cond_.notify_one();
+}
+
+bool DecoderWorkerPool::TryGetTask(int32 worker_index, std::function<void()> *task) {
+	{
+		TaskQueue *own = queues_[worker_index];
+		std::lock_guard<std::mutex> queue_locker(own->queue_mtx_);
+		if (!own->tasks_.empty()) {
+			*task = own->tasks_.front();
+			own->tasks_.pop_front();
+			num_queued_.fetch_sub(1);
+			return true;
+		}
+	}
+	for (size_t i = 1; i < queues_.size(); i++) {
+		TaskQueue *victim = queues_[(worker_index + i) % queues_.size()];
+		std::lock_guard<std::mutex> queue_locker(victim->queue_mtx_);
+		if (!victim->tasks_.empty()) {
+			*task = victim->tasks_.front();
+			victim->tasks_.pop_front();
+			num_queued_.fetch_sub(1);
+			return true;
+		}
+	}
+	return false;
+}
+
+void DecoderWorkerPool::WorkerLoop(int32 worker_index) {
+	current_worker_index = worker_index;
+	std::function<void()> task;
+	while (true) {
+		if (TryGetTask(worker_index, &task)) {
+			task();
+			continue;
+		}
+		std::unique_lock<std::mutex> sleep_locker(sleep_mtx_);
+		sleep_cond_.wait(sleep_locker, [this] { return this->num_queued_ > 0 || this->finished_; });
+		if (finished_ && num_queued_ == 0)
+			break;
+	}
+}
+
+DecoderWorkerPool::~DecoderWorkerPool() {
+	{
+		std::lock_guard<std::mutex> sleep_locker(sleep_mtx_);
+		finished_ = true;
+	}
+	sleep_cond_.notify_all();
+	for (size_t i = 0; i < workers_.size(); i++) {
+		workers_[i]->join();
+		delete workers_[i];
+	}
+	for (size_t i = 0; i < queues_.size(); i++)
+		delete queues_[i];
+}
+
+}
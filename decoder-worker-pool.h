@@ -0,0 +1,64 @@
+// 张; 杨
+#ifndef KALDI_DECODER_WORKER_POOL_H_
+#define KALDI_DECODER_WORKER_POOL_H_
+
+#include "base/kaldi-common.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kaldi {
+
+/// A fixed pool of decoding workers shared by all recognizers in the process.
+/// Every worker owns a task deque: tasks submitted from a worker go to the back
+/// of its own deque, and the worker takes them from the front (FIFO, so a
+/// stream that yields and resubmits itself runs after the tasks already
+/// waiting there), and an idle worker steals from the front of the other
+/// workers' deques. Tasks submitted from other threads are spread over the
+/// deques round robin.
+class DecoderWorkerPool {
+ public:
+	// the pool is created by the first call; num_workers <= 0 means one worker
+	// per hardware thread, and is ignored once the pool exists
+	static DecoderWorkerPool &Instance(int32 num_workers);
+
+	void Submit(const std::function<void()> &task);
+
+	int32 NumWorkers() const { return workers_.size(); }
+
+	~DecoderWorkerPool();
+
+ private:
+	explicit DecoderWorkerPool(int32 num_workers);
+
+	void WorkerLoop(int32 worker_index);
+
+	// pop from the front of our own deque, or steal from the front of another
+	bool TryGetTask(int32 worker_index, std::function<void()> *task);
+
+	struct TaskQueue {
+		std::mutex queue_mtx_;
+		std::deque<std::function<void()> > tasks_;
+	};
+
+	std::vector<TaskQueue*> queues_;
+	std::vector<std::thread*> workers_;
+
+	// idle workers sleep here until num_queued_ becomes nonzero
+	std::mutex sleep_mtx_;
+	std::condition_variable sleep_cond_;
+	std::atomic<int32> num_queued_;
+	std::atomic<uint32> next_queue_;
+	bool finished_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(DecoderWorkerPool);
+};
+
+}
+
+#endif  // KALDI_DECODER_WORKER_POOL_H_
@@ -0,0 +1,169 @@
+// 张; 杨
+#include "onlinedecoder/json-writer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace kaldi {
+
+static std::string RealString(double value) {
+  std::string str;
+  AppendReal(value, &str);
+  return str;
+}
+
+// what jansson's dtostr writes with JSON_REAL_PRECISION(6)
+// Reference: jansson dtostr
+static std::string JanssonReal(double value) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.6g", value);
+  size_t length = strlen(buf);
+  if (strchr(buf, '.') == NULL && strchr(buf, 'e') == NULL) {
+    buf[length++] = '.';
+    buf[length++] = '0';
+    buf[length] = '\0';
+  }
+  char *start = strchr(buf, 'e');
+  if (start != NULL) {
+    start++;
+    char *end = start + 1;
+    if (*start == '-')
+      start++;
+    while (*end == '0')
+      end++;
+    if (end != start) {
+      memmove(start, end, length - (end - buf) + 1);
+      length -= end - start;
+    }
+  }
+  return std::string(buf, length);
+}
+
+void UnitTestAppendReal() {
+  KALDI_ASSERT(RealString(0.0) == "0.0");
+  KALDI_ASSERT(RealString(1.0) == "1.0");
+  KALDI_ASSERT(RealString(-2.5) == "-2.5");
+  KALDI_ASSERT(RealString(0.1) == "0.1");
+  KALDI_ASSERT(RealString(0.0001) == "0.0001");
+  KALDI_ASSERT(RealString(123456.0) == "123456.0");
+  KALDI_ASSERT(RealString(1234567.0) == "1.23457e6");
+  KALDI_ASSERT(RealString(1e6) == "1e6");
+  KALDI_ASSERT(RealString(1e-5) == "1e-5");
+  KALDI_ASSERT(RealString(-3.25e-5) == "-3.25e-5");
+  KALDI_ASSERT(RealString(1e100) == "1e100");
+  KALDI_ASSERT(RealString(1e-100) == "1e-100");
+  KALDI_ASSERT(RealString(0.333333333) == "0.333333");
+  KALDI_ASSERT(RealString(0.99999999) == "1.0");
+}
+
+// reals of all magnitudes, and the frame times and confidences of results
+void UnitTestAppendRealMatchesJansson() {
+  for (int32 i = 0; i < 100000; i++) {
+    double value = RandUniform() * pow(10.0, RandInt(-12, 12));
+    if (i % 3 == 0)
+      value = RandInt(0, 100000) * 0.03;
+    else if (i % 3 == 1)
+      value = RandInt(0, 1000) / 1024.0;
+    if (i % 2 == 0)
+      value = -value;
+    if (RealString(value) != JanssonReal(value))
+      KALDI_ERR << "AppendReal(" << value << ") is " << RealString(value)
+                << ", jansson writes " << JanssonReal(value);
+  }
+}
+
+// doubles whose seventh significant digit is a 5 and whose product with the
+// power of 10 rounds to an exact tie, although the value is not one
+void UnitTestAppendRealNearTies() {
+  KALDI_ASSERT(RealString(195.33250000000001) == "195.333");
+  KALDI_ASSERT(RealString(195.33250000000001) == JanssonReal(195.33250000000001));
+  for (int32 i = 0; i < 1000000; i++) {
+    double value = RandInt(0, 100000000) * (i % 2 == 0 ? 0.01 : 0.0005);
+    if (i % 3 == 0)
+      value *= 1e-3;
+    if (RealString(value) != JanssonReal(value))
+      KALDI_ERR << "AppendReal(" << value << ") is " << RealString(value)
+                << ", jansson writes " << JanssonReal(value);
+  }
+}
+
+void UnitTestJsonWriter() {
+  JsonWriter json;
+  json.BeginObject();
+  json.Key("speaker");
+  json.String("a\"b\\c\n\x01");
+  json.Key("result");
+  json.BeginObject();
+  json.Key("final");
+  json.Bool(true);
+  json.Key("hypotheses");
+  json.BeginArray();
+  json.BeginObject();
+  json.Key("likelihood");
+  json.Real(-12.5);
+  json.EndObject();
+  json.BeginObject();
+  json.EndObject();
+  json.EndArray();
+  json.EndObject();
+  json.EndObject();
+  KALDI_ASSERT(json.Str() == "{\"speaker\": \"a\\\"b\\\\c\\n\\u0001\", \"result\": "
+               "{\"final\": true, \"hypotheses\": [{\"likelihood\": -12.5}, {}]}}");
+
+  // Clear starts a new document
+  json.Clear();
+  json.BeginArray();
+  json.Real(1.0);
+  json.EndArray();
+  KALDI_ASSERT(json.Str() == "[1.0]");
+}
+
+// json_real refuses non-finite values, so jansson leaves out their key, or
+// their element in an array
+void UnitTestNonFiniteReal() {
+  double inf = std::numeric_limits<double>::infinity();
+  double nan = std::numeric_limits<double>::quiet_NaN();
+  JsonWriter json;
+  json.BeginObject();
+  json.Key("first");
+  json.Real(nan);
+  json.Key("start");
+  json.Real(0.5);
+  json.Key("length");
+  json.Real(inf);
+  json.Key("confidence");
+  json.Real(1.0);
+  json.Key("last");
+  json.Real(-inf);
+  json.EndObject();
+  KALDI_ASSERT(json.Str() == "{\"start\": 0.5, \"confidence\": 1.0}");
+
+  json.Clear();
+  json.BeginObject();
+  json.Key("only");
+  json.Real(nan);
+  json.Key("array");
+  json.BeginArray();
+  json.Real(inf);
+  json.Real(2.0);
+  json.Real(nan);
+  json.Real(3.0);
+  json.EndArray();
+  json.EndObject();
+  KALDI_ASSERT(json.Str() == "{\"array\": [2.0, 3.0]}");
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestAppendReal();
+  UnitTestAppendRealMatchesJansson();
+  UnitTestAppendRealNearTies();
+  UnitTestJsonWriter();
+  UnitTestNonFiniteReal();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -0,0 +1,199 @@
+// 张; 杨
+#include "onlinedecoder/json-writer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace kaldi {
+
+static const double kPowersOf10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+};
+
+// Reference: jansson dtostr
+void AppendReal(double value, std::string *str) {
+	size_t begin = str->size();
+	double abs_value = std::fabs(value);
+	if (abs_value >= 1e-4 && abs_value < 1e6) {
+		// "%.6g" prints six significant digits in fixed notation for decimal
+		// exponents -4 to 5: scale them to an integer and place the point
+		int32 exponent = static_cast<int32>(std::floor(std::log10(abs_value)));
+		double scaled = abs_value * kPowersOf10[5 - exponent];
+		double digits = std::nearbyint(scaled);
+		// log10 may be off by one near powers of 10, and rounding may carry
+		if (digits >= 1e6 && exponent < 5) {
+			exponent++;
+			scaled = abs_value * kPowersOf10[5 - exponent];
+			digits = std::nearbyint(scaled);
+		} else if (digits < 1e5 && exponent > -4) {
+			exponent--;
+			scaled = abs_value * kPowersOf10[5 - exponent];
+			digits = std::nearbyint(scaled);
+		}
+		// the product is rounded, by less than 1e-9 below 1e6, so it may
+		// round the other way than the exact value when that is about halfway
+		// between two integers: 195.33250000000001 is "195.333", but its
+		// product 195332.5 exactly. printf decides those
+		bool near_tie = std::fabs(scaled - std::floor(scaled) - 0.5) < 1e-6;
+		if (!near_tie && digits >= 1e5 && digits < 1e6) {
+			char buf[16];
+			int32 m = static_cast<int32>(digits);
+			for (int32 i = 5; i >= 0; i--) {
+				buf[i] = '0' + m % 10;
+				m /= 10;
+			}
+			int32 num_digits = 6;
+			// trailing zeros of the fraction are dropped
+			int32 num_int_digits = std::max<int32>(exponent + 1, 0);
+			while (num_digits > num_int_digits && buf[num_digits - 1] == '0')
+				num_digits--;
+			if (value < 0)
+				str->push_back('-');
+			if (exponent < 0) {
+				str->append("0.");
+				str->append(-exponent - 1, '0');
+				str->append(buf, num_digits);
+			} else {
+				str->append(buf, num_int_digits);
+				if (num_digits > num_int_digits) {
+					str->push_back('.');
+					str->append(buf + num_int_digits, num_digits - num_int_digits);
+				} else {
+					str->append(".0");
+				}
+			}
+			return;
+		}
+	}
+
+	char buf[32];
+	int32 length = snprintf(buf, sizeof(buf), "%.6g", value);
+	// jansson drops the '+' and the leading zeros of the exponent, "1e+06"
+	// is written "1e6" and "1e-05" "1e-5"
+	char *exponent = strchr(buf, 'e');
+	if (exponent != NULL) {
+		char *start = exponent + 1;
+		if (*start == '-')
+			start++;
+		char *end = exponent + 1;
+		if (*end == '+' || *end == '-')
+			end++;
+		while (*end == '0' && end[1] != '\0')
+			end++;
+		memmove(start, end, buf + length + 1 - end);
+		length -= end - start;
+	}
+	str->append(buf, length);
+	// jansson makes sure the value reads back as a real
+	for (size_t i = begin; i < str->size(); i++) {
+		char c = (*str)[i];
+		if (c == '.' || c == 'e' || c == 'E')
+			return;
+	}
+	str->append(".0");
+}
+
+void JsonWriter::Clear() {
+	buffer_.clear();
+	open_.clear();
+}
+
+void JsonWriter::BeginValue() {
+	if (!open_.empty() && open_.back().is_array) {
+		if (!open_.back().empty)
+			buffer_.append(", ");
+		open_.back().empty = false;
+	}
+}
+
+void JsonWriter::BeginObject() {
+	BeginValue();
+	buffer_.push_back('{');
+	Container object = { false, true };
+	open_.push_back(object);
+}
+
+void JsonWriter::EndObject() {
+	KALDI_ASSERT(!open_.empty() && !open_.back().is_array);
+	open_.pop_back();
+	buffer_.push_back('}');
+}
+
+void JsonWriter::BeginArray() {
+	BeginValue();
+	buffer_.push_back('[');
+	Container array = { true, true };
+	open_.push_back(array);
+}
+
+void JsonWriter::EndArray() {
+	KALDI_ASSERT(!open_.empty() && open_.back().is_array);
+	open_.pop_back();
+	buffer_.push_back(']');
+}
+
+void JsonWriter::Key(const char *key) {
+	KALDI_ASSERT(!open_.empty() && !open_.back().is_array);
+	key_start_ = buffer_.size();
+	key_container_empty_ = open_.back().empty;
+	if (!open_.back().empty)
+		buffer_.append(", ");
+	open_.back().empty = false;
+	buffer_.push_back('"');
+	AppendEscaped(key, strlen(key));
+	buffer_.append("\": ");
+}
+
+void JsonWriter::String(const std::string &value) {
+	BeginValue();
+	buffer_.push_back('"');
+	AppendEscaped(value.data(), value.size());
+	buffer_.push_back('"');
+}
+
+void JsonWriter::Real(double value) {
+	if (!KALDI_ISFINITE(value)) {
+		// json_real refuses these, so jansson leaves out the key or the
+		// array element
+		if (!open_.empty() && !open_.back().is_array) {
+			buffer_.resize(key_start_);
+			open_.back().empty = key_container_empty_;
+		}
+		return;
+	}
+	BeginValue();
+	AppendReal(value, &buffer_);
+}
+
+void JsonWriter::Bool(bool value) {
+	BeginValue();
+	buffer_.append(value ? "true" : "false");
+}
+
+// Reference: jansson dump_string, without JSON_ENSURE_ASCII
+void JsonWriter::AppendEscaped(const char *str, size_t length) {
+	static const char kHex[] = "0123456789abcdef";
+	for (size_t i = 0; i < length; i++) {
+		unsigned char c = str[i];
+		switch (c) {
+			case '"': buffer_.append("\\\""); break;
+			case '\\': buffer_.append("\\\\"); break;
+			case '\b': buffer_.append("\\b"); break;
+			case '\f': buffer_.append("\\f"); break;
+			case '\n': buffer_.append("\\n"); break;
+			case '\r': buffer_.append("\\r"); break;
+			case '\t': buffer_.append("\\t"); break;
+			default:
+				if (c < 0x20) {
+					buffer_.append("\\u00");
+					buffer_.push_back(kHex[c >> 4]);
+					buffer_.push_back(kHex[c & 0xf]);
+				} else {
+					buffer_.push_back(c);
+				}
+		}
+	}
+}
+
+}
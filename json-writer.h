@@ -0,0 +1,62 @@
+// 张; 杨
+#ifndef KALDI_JSON_WRITER_H_
+#define KALDI_JSON_WRITER_H_
+
+#include "base/kaldi-common.h"
+
+#include <string>
+#include <vector>
+
+namespace kaldi {
+
+/// Writes JSON straight into a string that keeps its capacity from one
+/// document to the next, in the layout json_dumps(root, JSON_REAL_PRECISION(6))
+/// of jansson produces: ", " and ": " separators, reals as "%.6g" with ".0"
+/// appended to integral values and exponents without '+' or leading zeros,
+/// and non-finite reals left out with their key.
+class JsonWriter {
+ public:
+	JsonWriter(): key_start_(0), key_container_empty_(true) {}
+
+	// start a new document, keeping the memory of the previous one
+	void Clear();
+
+	void BeginObject();
+	void EndObject();
+	void BeginArray();
+	void EndArray();
+
+	// the key of the next value in the current object
+	void Key(const char *key);
+
+	void String(const std::string &value);
+	void Real(double value);
+	void Bool(bool value);
+
+	const std::string &Str() const { return buffer_; }
+
+ private:
+	// the separator before a value in an array; in an object Key() writes it
+	void BeginValue();
+	void AppendEscaped(const char *str, size_t length);
+
+	struct Container {
+		bool is_array;
+		// true until it has its first element
+		bool empty;
+	};
+
+	std::string buffer_;
+	std::vector<Container> open_;
+	// end of the buffer before the last key, to drop it with a non-finite real
+	size_t key_start_;
+	bool key_container_empty_;
+};
+
+// append value as printf("%.6g") does for any double, with ".0" if it looks
+// like an integer and the exponent shortened as jansson does
+void AppendReal(double value, std::string *str);
+
+}
+
+#endif  // KALDI_JSON_WRITER_H_
@@ -0,0 +1,108 @@
+// 张; 杨
+#include "onlinedecoder/online-block-feature.h"
+
+#include <cmath>
+
+namespace kaldi {
+
+// a tone with noise, and a stretch of digital silence for the energy floors
+static void RandomWaveform(BaseFloat samp_freq, Vector<BaseFloat> *wave) {
+  int32 num_samples = RandInt(0, 20000);
+  wave->Resize(num_samples);
+  BaseFloat freq = RandInt(100, 3000);
+  for (int32 i = 0; i < num_samples; i++)
+    (*wave)(i) = 5000.0 * sin(2.0 * M_PI * freq * i / samp_freq) + 500.0 * RandGauss();
+  int32 silence_start = RandInt(0, num_samples / 2);
+  wave->Range(silence_start, std::min(num_samples - silence_start, 800)).SetZero();
+}
+
+static std::string RandomWindowType() {
+  const char *window_types[] = { "hamming", "hanning", "povey", "rectangular", "blackman" };
+  return window_types[RandInt(0, 4)];
+}
+
+// the frame options Kaldi's and the block features both support, without
+// dither so they see the same samples
+static void RandomFrameOptions(int32 i, FrameExtractionOptions *frame_opts) {
+  frame_opts->dither = 0.0;
+  frame_opts->samp_freq = (RandInt(0, 1) == 0 ? 8000.0 : 16000.0);
+  frame_opts->snip_edges = (i % 2 == 0);
+  frame_opts->round_to_power_of_two = (RandInt(0, 3) != 0);
+  frame_opts->remove_dc_offset = (RandInt(0, 1) == 0);
+  frame_opts->preemph_coeff = (RandInt(0, 1) == 0 ? 0.97 : 0.0);
+  frame_opts->window_type = RandomWindowType();
+}
+
+// feeds the same random chunks to both, so the frames ready are compared
+// after each chunk and not only at the end
+template <class C, class R>
+static void CompareWithKaldi(const typename C::Options &opts) {
+  BaseFloat samp_freq = opts.frame_opts.samp_freq;
+  Vector<BaseFloat> wave;
+  RandomWaveform(samp_freq, &wave);
+  OnlineBlockFeature<C> block_feature(opts);
+  R reference_feature(opts);
+  KALDI_ASSERT(block_feature.Dim() == reference_feature.Dim());
+
+  int32 offset = 0;
+  while (offset < wave.Dim()) {
+    int32 chunk_length = std::min(RandInt(1, 3000), wave.Dim() - offset);
+    SubVector<BaseFloat> chunk(wave, offset, chunk_length);
+    block_feature.AcceptWaveform(samp_freq, chunk);
+    reference_feature.AcceptWaveform(samp_freq, chunk);
+    KALDI_ASSERT(block_feature.NumFramesReady() == reference_feature.NumFramesReady());
+    offset += chunk_length;
+  }
+  block_feature.InputFinished();
+  reference_feature.InputFinished();
+  int32 num_frames = reference_feature.NumFramesReady();
+  KALDI_ASSERT(block_feature.NumFramesReady() == num_frames);
+
+  Vector<BaseFloat> block_frame(block_feature.Dim()), reference_frame(reference_feature.Dim());
+  for (int32 t = 0; t < num_frames; t++) {
+    KALDI_ASSERT(block_feature.IsLastFrame(t) == reference_feature.IsLastFrame(t));
+    block_feature.GetFrame(t, &block_frame);
+    reference_feature.GetFrame(t, &reference_frame);
+    if (!block_frame.ApproxEqual(reference_frame, 1.0e-03))
+      KALDI_ERR << "Frame " << t << " of " << num_frames << " differs: block features "
+                << block_frame << ", Kaldi's " << reference_frame;
+  }
+}
+
+void UnitTestOnlineBlockMfcc() {
+  for (int32 i = 0; i < 64; i++) {
+    MfccOptions opts;
+    RandomFrameOptions(i, &(opts.frame_opts));
+    opts.htk_compat = ((i >> 1) % 2 == 0);
+    opts.use_energy = ((i >> 2) % 2 == 0);
+    opts.raw_energy = ((i >> 3) % 2 == 0);
+    opts.energy_floor = ((i >> 4) % 2 == 0 ? 0.0 : 1.0);
+    opts.mel_opts.htk_mode = ((i >> 5) % 2 == 0);
+    opts.cepstral_lifter = (RandInt(0, 1) == 0 ? 22.0 : 0.0);
+    CompareWithKaldi<BlockMfccComputer, OnlineMfcc>(opts);
+  }
+}
+
+void UnitTestOnlineBlockFbank() {
+  for (int32 i = 0; i < 64; i++) {
+    FbankOptions opts;
+    RandomFrameOptions(i, &(opts.frame_opts));
+    opts.htk_compat = ((i >> 1) % 2 == 0);
+    opts.use_energy = ((i >> 2) % 2 == 0);
+    opts.raw_energy = ((i >> 3) % 2 == 0);
+    opts.use_power = ((i >> 4) % 2 == 0);
+    opts.use_log_fbank = ((i >> 5) % 2 == 0);
+    opts.energy_floor = (RandInt(0, 1) == 0 ? 0.0 : 1.0);
+    CompareWithKaldi<BlockFbankComputer, OnlineFbank>(opts);
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestOnlineBlockMfcc();
+  UnitTestOnlineBlockFbank();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -0,0 +1,305 @@
+// 张; 杨
+#include "onlinedecoder/online-block-feature.h"
+#include "feat/feature-functions.h"
+#include "matrix/matrix-functions.h"
+
+#include <limits>
+
+namespace kaldi {
+
+BlockMelSpectrum::BlockMelSpectrum(const FrameExtractionOptions &frame_opts,
+                                   const MelBanksOptions &mel_opts):
+	srfft_(NULL), htk_mode_(mel_opts.htk_mode) {
+	int32 padded_window_size = frame_opts.PaddedWindowSize();
+	if ((padded_window_size & (padded_window_size - 1)) == 0)
+		this->srfft_ = new SplitRadixRealFft<BaseFloat>(padded_window_size);
+
+	// the sparse bins of MelBanks as one dense matrix
+	MelBanks mel_banks(mel_opts, frame_opts, 1.0);
+	const std::vector<std::pair<int32, Vector<BaseFloat> > > &bins = mel_banks.GetBins();
+	this->mel_matrix_.Resize(bins.size(), padded_window_size / 2 + 1);
+	for (size_t i = 0; i < bins.size(); i++) {
+		this->mel_matrix_.Row(i).Range(bins[i].first, bins[i].second.Dim()).CopyFromVec(
+			bins[i].second);
+	}
+}
+
+BlockMelSpectrum::~BlockMelSpectrum() {
+	delete this->srfft_;
+}
+
+// Reference: MelBanks::Compute
+void BlockMelSpectrum::Compute(bool use_power, MatrixBase<BaseFloat> *windows,
+                               MatrixBase<BaseFloat> *mel_energies) const {
+	int32 num_frames = windows->NumRows(), padded_window_size = windows->NumCols();
+	KALDI_ASSERT(mel_energies->NumRows() == num_frames &&
+	             mel_energies->NumCols() == this->mel_matrix_.NumRows());
+	for (int32 i = 0; i < num_frames; i++) {
+		SubVector<BaseFloat> window(*windows, i);
+		if (this->srfft_ != NULL)
+			this->srfft_->Compute(window.Data(), true);
+		else
+			RealFft(&window, true);
+		ComputePowerSpectrum(&window);
+	}
+	SubMatrix<BaseFloat> power_spectrum(*windows, 0, num_frames, 0, padded_window_size / 2 + 1);
+	if (!use_power)
+		power_spectrum.ApplyPow(0.5);
+	mel_energies->AddMatMat(1.0, power_spectrum, kNoTrans, this->mel_matrix_, kTrans, 0.0);
+	if (this->htk_mode_)
+		mel_energies->ApplyFloor(1.0);
+}
+
+// log energy of each frame, from the window itself unless raw_energy
+static void ComputeLogEnergy(bool raw_energy, BaseFloat energy_floor,
+                             BaseFloat log_energy_floor,
+                             const VectorBase<BaseFloat> &raw_log_energy,
+                             const MatrixBase<BaseFloat> &windows,
+                             Vector<BaseFloat> *log_energy) {
+	log_energy->Resize(windows.NumRows(), kUndefined);
+	if (raw_energy) {
+		log_energy->CopyFromVec(raw_log_energy);
+	} else {
+		log_energy->AddDiagMat2(1.0, windows, kNoTrans, 0.0);
+		log_energy->ApplyFloor(std::numeric_limits<float>::epsilon());
+		log_energy->ApplyLog();
+	}
+	if (energy_floor > 0.0)
+		log_energy->ApplyFloor(log_energy_floor);
+}
+
+BlockMfccComputer::BlockMfccComputer(const MfccOptions &opts):
+	opts_(opts),
+	mel_spectrum_(opts.frame_opts, opts.mel_opts),
+	log_energy_floor_(0.0) {
+	int32 num_bins = opts.mel_opts.num_bins;
+	if (opts.num_ceps > num_bins)
+		KALDI_ERR << "num-ceps cannot be larger than num-mel-bins."
+		          << " It should be smaller or equal. You provided num-ceps: "
+		          << opts.num_ceps << "  and num-mel-bins: " << num_bins;
+
+	Matrix<BaseFloat> dct_matrix(num_bins, num_bins);
+	ComputeDctMatrix(&dct_matrix);
+	this->dct_matrix_ = dct_matrix.RowRange(0, opts.num_ceps);
+	if (opts.cepstral_lifter != 0.0) {
+		this->lifter_coeffs_.Resize(opts.num_ceps);
+		ComputeLifterCoeffs(opts.cepstral_lifter, &this->lifter_coeffs_);
+	}
+	if (opts.energy_floor > 0.0)
+		this->log_energy_floor_ = Log(opts.energy_floor);
+}
+
+void BlockMfccComputer::Compute(const VectorBase<BaseFloat> &raw_log_energy,
+                                MatrixBase<BaseFloat> *windows,
+                                MatrixBase<BaseFloat> *features) {
+	int32 num_frames = windows->NumRows(), num_ceps = this->opts_.num_ceps;
+	if (this->opts_.use_energy)
+		ComputeLogEnergy(this->opts_.raw_energy, this->opts_.energy_floor, this->log_energy_floor_,
+		                 raw_log_energy, *windows, &this->log_energy_);
+
+	this->mel_energies_.Resize(num_frames, this->opts_.mel_opts.num_bins, kUndefined);
+	this->mel_spectrum_.Compute(true, windows, &this->mel_energies_);
+	this->mel_energies_.ApplyFloor(std::numeric_limits<float>::epsilon());
+	this->mel_energies_.ApplyLog();
+
+	features->AddMatMat(1.0, this->mel_energies_, kNoTrans, this->dct_matrix_, kTrans, 0.0);
+	if (this->opts_.cepstral_lifter != 0.0)
+		features->MulColsVec(this->lifter_coeffs_);
+	if (this->opts_.use_energy)
+		features->CopyColFromVec(this->log_energy_, 0);
+
+	if (this->opts_.htk_compat) {
+		// c0 or the energy goes last
+		for (int32 i = 0; i < num_frames; i++) {
+			BaseFloat *feature = features->RowData(i);
+			BaseFloat energy = feature[0];
+			for (int32 j = 0; j < num_ceps - 1; j++)
+				feature[j] = feature[j + 1];
+			if (!this->opts_.use_energy)
+				energy *= M_SQRT2;
+			feature[num_ceps - 1] = energy;
+		}
+	}
+}
+
+BlockFbankComputer::BlockFbankComputer(const FbankOptions &opts):
+	opts_(opts),
+	mel_spectrum_(opts.frame_opts, opts.mel_opts),
+	log_energy_floor_(0.0) {
+	if (opts.energy_floor > 0.0)
+		this->log_energy_floor_ = Log(opts.energy_floor);
+}
+
+void BlockFbankComputer::Compute(const VectorBase<BaseFloat> &raw_log_energy,
+                                 MatrixBase<BaseFloat> *windows,
+                                 MatrixBase<BaseFloat> *features) {
+	int32 num_frames = windows->NumRows(), num_bins = this->opts_.mel_opts.num_bins;
+	if (this->opts_.use_energy)
+		ComputeLogEnergy(this->opts_.raw_energy, this->opts_.energy_floor, this->log_energy_floor_,
+		                 raw_log_energy, *windows, &this->log_energy_);
+
+	int32 mel_offset = (this->opts_.use_energy && !this->opts_.htk_compat) ? 1 : 0;
+	SubMatrix<BaseFloat> mel_energies(*features, 0, num_frames, mel_offset, num_bins);
+	this->mel_spectrum_.Compute(this->opts_.use_power, windows, &mel_energies);
+	if (this->opts_.use_log_fbank) {
+		mel_energies.ApplyFloor(std::numeric_limits<float>::epsilon());
+		mel_energies.ApplyLog();
+	}
+
+	if (this->opts_.use_energy)
+		features->CopyColFromVec(this->log_energy_, this->opts_.htk_compat ? num_bins : 0);
+}
+
+template <class C>
+OnlineBlockFeature<C>::OnlineBlockFeature(const typename C::Options &opts):
+	computer_(opts),
+	window_function_(computer_.GetFrameOptions()),
+	num_frames_(0),
+	waveform_offset_(0),
+	input_finished_(false) {
+}
+
+template <class C>
+void OnlineBlockFeature<C>::GetFrame(int32 frame, VectorBase<BaseFloat> *feat) {
+	KALDI_ASSERT(frame >= 0 && frame < this->num_frames_);
+	feat->CopyFromVec(this->features_.Row(frame));
+}
+
+// Reference: OnlineGenericBaseFeature::AcceptWaveform
+template <class C>
+void OnlineBlockFeature<C>::AcceptWaveform(BaseFloat sampling_rate,
+                                           const VectorBase<BaseFloat> &waveform) {
+	BaseFloat expected_sampling_rate = this->computer_.GetFrameOptions().samp_freq;
+	if (sampling_rate != expected_sampling_rate)
+		KALDI_ERR << "Sampling frequency mismatch, expected "
+		          << expected_sampling_rate << ", got " << sampling_rate;
+	if (waveform.Dim() == 0)
+		return;
+	if (this->input_finished_)
+		KALDI_ERR << "AcceptWaveform called after InputFinished() was called.";
+
+	Vector<BaseFloat> appended_wave(this->waveform_remainder_.Dim() + waveform.Dim(), kUndefined);
+	if (this->waveform_remainder_.Dim() != 0)
+		appended_wave.Range(0, this->waveform_remainder_.Dim()).CopyFromVec(
+			this->waveform_remainder_);
+	appended_wave.Range(this->waveform_remainder_.Dim(), waveform.Dim()).CopyFromVec(waveform);
+	this->waveform_remainder_.Swap(&appended_wave);
+	this->ComputeFeatures();
+}
+
+template <class C>
+void OnlineBlockFeature<C>::InputFinished() {
+	this->input_finished_ = true;
+	this->ComputeFeatures();
+}
+
+// Reference: OnlineGenericBaseFeature::ComputeFeatures
+template <class C>
+void OnlineBlockFeature<C>::ComputeFeatures() {
+	const FrameExtractionOptions &frame_opts = this->computer_.GetFrameOptions();
+	int64 num_samples_total = this->waveform_offset_ + this->waveform_remainder_.Dim();
+	int32 num_frames_new = NumFrames(num_samples_total, frame_opts, this->input_finished_);
+	int32 num_block_frames = num_frames_new - this->num_frames_;
+
+	if (num_block_frames > 0) {
+		if (this->features_.NumRows() < num_frames_new)
+			this->features_.Resize(std::max(num_frames_new, 2 * this->features_.NumRows()),
+			                       this->computer_.Dim(), kCopyData);
+		this->ExtractWindows(this->num_frames_, num_block_frames);
+		SubMatrix<BaseFloat> windows(this->windows_, 0, num_block_frames,
+		                             0, this->windows_.NumCols());
+		SubMatrix<BaseFloat> features(this->features_, this->num_frames_, num_block_frames,
+		                              0, this->computer_.Dim());
+		this->computer_.Compute(this->raw_log_energy_, &windows, &features);
+		this->num_frames_ = num_frames_new;
+	}
+
+	// discard the samples no later frame needs
+	int64 first_sample_of_next_frame = FirstSampleOfFrame(num_frames_new, frame_opts);
+	int32 samples_to_discard = first_sample_of_next_frame - this->waveform_offset_;
+	if (samples_to_discard > 0) {
+		int32 new_num_samples = this->waveform_remainder_.Dim() - samples_to_discard;
+		if (new_num_samples <= 0) {
+			this->waveform_offset_ += this->waveform_remainder_.Dim();
+			this->waveform_remainder_.Resize(0);
+		} else {
+			Vector<BaseFloat> new_remainder(new_num_samples, kUndefined);
+			new_remainder.CopyFromVec(this->waveform_remainder_.Range(samples_to_discard,
+			                                                          new_num_samples));
+			this->waveform_offset_ += samples_to_discard;
+			this->waveform_remainder_.Swap(&new_remainder);
+		}
+	}
+}
+
+// Reference: ExtractWindow, ProcessWindow
+template <class C>
+void OnlineBlockFeature<C>::ExtractWindows(int32 first_frame, int32 num_frames) {
+	const FrameExtractionOptions &frame_opts = this->computer_.GetFrameOptions();
+	int32 frame_length = frame_opts.WindowSize(),
+		frame_length_padded = frame_opts.PaddedWindowSize();
+	if (this->windows_.NumRows() < num_frames)
+		this->windows_.Resize(num_frames, frame_length_padded, kUndefined);
+	SubMatrix<BaseFloat> frames(this->windows_, 0, num_frames, 0, frame_length);
+
+	int32 wave_dim = this->waveform_remainder_.Dim();
+	for (int32 i = 0; i < num_frames; i++) {
+		int64 start_sample = FirstSampleOfFrame(first_frame + i, frame_opts);
+		KALDI_ASSERT(start_sample >= this->waveform_offset_ ||
+		             (!frame_opts.snip_edges && this->waveform_offset_ == 0));
+		int32 wave_start = static_cast<int32>(start_sample - this->waveform_offset_);
+		SubVector<BaseFloat> frame(frames, i);
+		if (wave_start >= 0 && wave_start + frame_length <= wave_dim) {
+			frame.CopyFromVec(this->waveform_remainder_.Range(wave_start, frame_length));
+		} else {
+			// reflect at the edges of the signal, as without snip-edges
+			for (int32 s = 0; s < frame_length; s++) {
+				int32 s_in_wave = s + wave_start;
+				while (s_in_wave < 0 || s_in_wave >= wave_dim) {
+					if (s_in_wave < 0)
+						s_in_wave = -s_in_wave - 1;
+					else
+						s_in_wave = 2 * wave_dim - 1 - s_in_wave;
+				}
+				frame(s) = this->waveform_remainder_(s_in_wave);
+			}
+		}
+	}
+	// the FFT of the last block overwrote the padding
+	if (frame_length_padded > frame_length)
+		this->windows_.Range(0, num_frames, frame_length,
+		                     frame_length_padded - frame_length).SetZero();
+
+	if (frame_opts.dither != 0.0) {
+		for (int32 i = 0; i < num_frames; i++) {
+			BaseFloat *data = frames.RowData(i);
+			for (int32 s = 0; s < frame_length; s++)
+				data[s] += RandGauss(&this->random_state_) * frame_opts.dither;
+		}
+	}
+	if (frame_opts.remove_dc_offset) {
+		this->row_sums_.Resize(num_frames, kUndefined);
+		this->row_sums_.AddColSumMat(1.0, frames, 0.0);
+		frames.AddVecToCols(-1.0 / frame_length, this->row_sums_);
+	}
+	if (this->computer_.NeedRawLogEnergy()) {
+		this->raw_log_energy_.Resize(num_frames, kUndefined);
+		this->raw_log_energy_.AddDiagMat2(1.0, frames, kNoTrans, 0.0);
+		this->raw_log_energy_.ApplyFloor(std::numeric_limits<float>::epsilon());
+		this->raw_log_energy_.ApplyLog();
+	}
+	if (frame_opts.preemph_coeff != 0.0) {
+		// x[s] -= c * x[s - 1] on the samples before preemphasis, x[0] -= c * x[0]
+		this->preemph_copy_.Resize(num_frames, frame_length - 1, kUndefined);
+		this->preemph_copy_.CopyFromMat(frames.ColRange(0, frame_length - 1));
+		frames.ColRange(1, frame_length - 1).AddMat(-frame_opts.preemph_coeff,
+		                                            this->preemph_copy_);
+		frames.ColRange(0, 1).Scale(1.0 - frame_opts.preemph_coeff);
+	}
+	frames.MulColsVec(this->window_function_.window);
+}
+
+template class OnlineBlockFeature<BlockMfccComputer>;
+template class OnlineBlockFeature<BlockFbankComputer>;
+
+}
@@ -0,0 +1,155 @@
+// 张; 杨
+#ifndef KALDI_ONLINE_BLOCK_FEATURE_H_
+#define KALDI_ONLINE_BLOCK_FEATURE_H_
+
+#include "feat/online-feature.h"
+#include "feat/feature-mfcc.h"
+#include "feat/feature-fbank.h"
+#include "feat/mel-computations.h"
+#include "feat/srfft.h"
+
+namespace kaldi {
+
+/// Power spectrum and mel energies of a block of frames. The FFT plan is
+/// shared by all rows, and the mel filterbank is a dense matrix applied to
+/// the whole block with one matrix multiply.
+class BlockMelSpectrum {
+ public:
+	BlockMelSpectrum(const FrameExtractionOptions &frame_opts,
+	                 const MelBanksOptions &mel_opts);
+	~BlockMelSpectrum();
+
+	// windows has one padded window per row and is overwritten; mel_energies
+	// gets one row per window and one column per mel bin. With use_power
+	// false the magnitude spectrum is used, as FbankOptions::use_power.
+	void Compute(bool use_power, MatrixBase<BaseFloat> *windows,
+	             MatrixBase<BaseFloat> *mel_energies) const;
+
+	int32 NumBins() const { return mel_matrix_.NumRows(); }
+
+ private:
+	// NULL if the padded window size isn't a power of two
+	SplitRadixRealFft<BaseFloat> *srfft_;
+	// one row per mel bin, one column per frequency of the power spectrum
+	Matrix<BaseFloat> mel_matrix_;
+	bool htk_mode_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(BlockMelSpectrum);
+};
+
+/// MfccComputer on a block of frames.
+/// Reference: MfccComputer::Compute
+class BlockMfccComputer {
+ public:
+	typedef MfccOptions Options;
+
+	explicit BlockMfccComputer(const MfccOptions &opts);
+
+	const FrameExtractionOptions &GetFrameOptions() const { return opts_.frame_opts; }
+	int32 Dim() const { return opts_.num_ceps; }
+	bool NeedRawLogEnergy() const { return opts_.use_energy && opts_.raw_energy; }
+
+	// raw_log_energy is only used if NeedRawLogEnergy(); windows is
+	// overwritten and features has a row per window
+	void Compute(const VectorBase<BaseFloat> &raw_log_energy,
+	             MatrixBase<BaseFloat> *windows,
+	             MatrixBase<BaseFloat> *features);
+
+ private:
+	MfccOptions opts_;
+	BlockMelSpectrum mel_spectrum_;
+	// the first num_ceps rows of the DCT matrix
+	Matrix<BaseFloat> dct_matrix_;
+	Vector<BaseFloat> lifter_coeffs_;
+	BaseFloat log_energy_floor_;
+	Vector<BaseFloat> log_energy_;
+	Matrix<BaseFloat> mel_energies_;
+};
+
+/// FbankComputer on a block of frames.
+/// Reference: FbankComputer::Compute
+class BlockFbankComputer {
+ public:
+	typedef FbankOptions Options;
+
+	explicit BlockFbankComputer(const FbankOptions &opts);
+
+	const FrameExtractionOptions &GetFrameOptions() const { return opts_.frame_opts; }
+	int32 Dim() const { return opts_.mel_opts.num_bins + (opts_.use_energy ? 1 : 0); }
+	bool NeedRawLogEnergy() const { return opts_.use_energy && opts_.raw_energy; }
+
+	void Compute(const VectorBase<BaseFloat> &raw_log_energy,
+	             MatrixBase<BaseFloat> *windows,
+	             MatrixBase<BaseFloat> *features);
+
+ private:
+	FbankOptions opts_;
+	BlockMelSpectrum mel_spectrum_;
+	BaseFloat log_energy_floor_;
+	Vector<BaseFloat> log_energy_;
+};
+
+/// OnlineGenericBaseFeature that computes all the frames a waveform
+/// completes as one block: the windows are extracted into the rows of a
+/// matrix and processed with matrix operations instead of frame by frame.
+/// Reference: OnlineGenericBaseFeature
+template <class C>
+class OnlineBlockFeature: public OnlineBaseFeature {
+ public:
+	explicit OnlineBlockFeature(const typename C::Options &opts);
+
+	virtual int32 Dim() const { return computer_.Dim(); }
+
+	virtual bool IsLastFrame(int32 frame) const {
+		return input_finished_ && frame == NumFramesReady() - 1;
+	}
+	virtual BaseFloat FrameShiftInSeconds() const {
+		return computer_.GetFrameOptions().frame_shift_ms / 1000.0f;
+	}
+
+	virtual int32 NumFramesReady() const { return num_frames_; }
+
+	virtual void GetFrame(int32 frame, VectorBase<BaseFloat> *feat);
+
+	virtual void AcceptWaveform(BaseFloat sampling_rate,
+	                            const VectorBase<BaseFloat> &waveform);
+
+	virtual void InputFinished();
+
+ private:
+	// compute the frames the waveform received so far completes
+	void ComputeFeatures();
+
+	// copy the windows of the given frames to the rows of windows_, and
+	// dither, remove the DC offset, preemphasize and window them
+	// Reference: ExtractWindow, ProcessWindow
+	void ExtractWindows(int32 first_frame, int32 num_frames);
+
+	C computer_;
+	FeatureWindowFunction window_function_;
+
+	// one row per frame, num_frames_ of them in use; grown by doubling
+	Matrix<BaseFloat> features_;
+	int32 num_frames_;
+
+	// the samples of the waveform from waveform_offset_ on
+	Vector<BaseFloat> waveform_remainder_;
+	int64 waveform_offset_;
+	bool input_finished_;
+
+	// reused between blocks
+	Matrix<BaseFloat> windows_;
+	Matrix<BaseFloat> preemph_copy_;
+	Vector<BaseFloat> raw_log_energy_;
+	Vector<BaseFloat> row_sums_;
+	RandomState random_state_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineBlockFeature);
+};
+
+typedef OnlineBlockFeature<BlockMfccComputer> OnlineBlockMfcc;
+typedef OnlineBlockFeature<BlockFbankComputer> OnlineBlockFbank;
+
+}
+
+#endif  // KALDI_ONLINE_BLOCK_FEATURE_H_
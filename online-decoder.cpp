@@ -2,30 +2,59 @@
 #include "onlinedecoder/online-decoder.h"
 #include "fst/script/project.h"
 
-#include <jansson.h>
-
-clock_t start_ss;
 std::vector<int32> silence_phones;
 using namespace kaldi;
+
+static int64 SteadyTimeNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 // load settings from config file
 // Reference: gst_kaldinnet2onlinedecoder_init
 OnlineDecoder::OnlineDecoder(int id, const string& configFilePath)
 {
 	id_ = id;
-	this->trans_model_ = NULL;
-	this->am_nnet3_ = NULL;
-	this->decode_fst_ = NULL;
 	this->feature_info_ = NULL;
-	this->word_syms_ = NULL;
-	this->phone_syms_ = NULL;
-	this->word_boundary_info_ = NULL;
-	this->decode_fst_ = NULL;
 	this->adaptation_state_ = NULL;
 	this->audio_source_ = NULL;
-	this->lm_fst_ = NULL;
-	this->lm_compose_cache_ = NULL;
 	this->sample_rate_ = 0;
+	this->resampler_ = NULL;
 	this->decode_thread_ = NULL;
+	this->task_scheduled_ = false;
+	this->num_tasks_ = 0;
+	this->audio_state_ = AudioState::SpkrContinue;
+	this->segment_active_ = false;
+	this->feature_pipeline_ = NULL;
+	this->silence_weighting_ = NULL;
+	this->initial_silence_weighting_ = NULL;
+	this->decoder_ = NULL;
+	this->search_type_ = kLatticeSearch;
+	this->finalizing_decoder_ = NULL;
+	this->finalize_thread_ = NULL;
+	this->finalize_pending_ = false;
+	this->finalize_done_ = false;
+	this->finalize_stop_ = false;
+	this->finalizing_ = false;
+	this->finalize_segment_start_time_ = 0.0;
+	this->finalize_total_time_decoded_ = 0.0;
+	this->finalize_ns_ = 0;
+	this->result_dispatcher_ = NULL;
+	this->full_result_storages_ = std::make_shared<RecogResultStoragePool>();
+	this->stats_audio_decoded_ = 0.0;
+	this->stats_decoding_secs_ = 0.0;
+	this->stats_recent_rtf_ = 0.0;
+	this->stats_frames_decoded_ = 0;
+	this->stats_active_tokens_ = 0;
+	this->last_partial_time_ns_ = 0;
+	this->last_final_time_ns_ = 0;
+	this->frames_decoded_before_segment_ = 0;
+	this->feature_thread_ = NULL;
+	this->feature_audio_state_ = AudioState::SpkrContinue;
+	this->pipeline_frames_decoded_ = 0;
+	this->pipeline_busy_ns_ = 0;
+	this->segment_wave_offset_ = 0;
+	this->carried_audio_state_ = AudioState::SpkrContinue;
 
   this->opts_ = new OnlineDecoderOptions();
 	this->endpoint_config_ = new OnlineEndpointConfig();
@@ -63,6 +92,21 @@ OnlineDecoder::OnlineDecoder(int id, const string& configFilePath)
   KALDI_ASSERT(!silence_phones.empty() &&
                "Endpointing requires nonempty --endpoint.silence-phones option");
                
+	if (this->opts_->async_callbacks_) {
+		ResultOverflowPolicy policy;
+		if (!ParseResultOverflowPolicy(this->opts_->callback_overflow_, &policy))
+			KALDI_ERR << "Bad --callback-overflow option: " << this->opts_->callback_overflow_;
+		this->result_dispatcher_ = &ResultDispatcher::Instance(this->opts_->num_callback_threads_,
+		                                                       this->opts_->callback_queue_size_,
+		                                                       policy);
+	}
+	if (!ParseStreamSearchType(this->opts_->decoder_type_, &(this->search_type_)))
+		KALDI_ERR << "Bad --decoder-type option: " << this->opts_->decoder_type_;
+	this->stage_timers_.SetEnabled(this->opts_->stage_timing_);
+	if (this->opts_->use_threaded_decoder_ &&
+	    (this->opts_->batch_nnet_ || this->opts_->use_worker_pool_))
+		KALDI_ERR << "--use-threaded-decoder can't be combined with --batch-nnet or --use-worker-pool";
+
 	// load models from files
 	this->LoadModel();
 
@@ -82,6 +126,17 @@ bool OnlineDecoder::LoadModel() {
 	}
 
 	this->sample_rate_ = (int) this->opts_->real_sample_rate_;
+
+	// audio at another rate than the models is resampled chunk by chunk,
+	// keeping the filter state across chunks
+	int32 model_sample_rate = (int32) this->feature_info_->mfcc_opts.frame_opts.samp_freq;
+	if (this->resampler_ == NULL && this->sample_rate_ != model_sample_rate) {
+		KALDI_LOG << "Resampling audio from " << this->sample_rate_ << " Hz to "
+		          << model_sample_rate << " Hz";
+		BaseFloat filter_cutoff = 0.99 * 0.5 * std::min(this->sample_rate_, model_sample_rate);
+		this->resampler_ = new LinearResample(this->sample_rate_, model_sample_rate,
+		                                      filter_cutoff, 6);
+	}
   
 	if (!this->adaptation_state_) {
 		this->adaptation_state_ = new OnlineIvectorExtractorAdaptationState(
@@ -99,207 +154,98 @@ bool OnlineDecoder::LoadModel() {
     }
 	}
 
-  if (!this->opts_->word_syms_filename_.empty()) {
-    this->LoadWordSyms();
-  }
-
-  if (!this->opts_->phone_syms_filename_.empty()) {
-	  this->LoadPhoneSyms();
+	// load the read-only models, or share them with recognizers already using them
+	DecoderModelConfig model_config;
+	model_config.model_rspecifier_ = this->opts_->model_rspecifier_;
+	model_config.fst_rspecifier_ = this->opts_->fst_rspecifier_;
+	model_config.lm_fst_rspecifier_ = this->opts_->lm_fst_rspecifier_;
+	model_config.big_lm_const_arpa_rspecifier_ = this->opts_->big_lm_const_arpa_rspecifier_;
+	model_config.word_syms_filename_ = this->opts_->word_syms_filename_;
+	model_config.phone_syms_filename_ = this->opts_->phone_syms_filename_;
+	model_config.word_boundary_info_filename_ = this->opts_->word_boundary_info_filename_;
+	model_config.map_fst_ = this->opts_->map_fst_;
+	model_config.cache_looped_computation_ = this->opts_->cache_looped_computation_;
+	model_config.batch_nnet_ = this->opts_->batch_nnet_;
+	model_config.batch_size_ = this->opts_->batch_size_;
+	model_config.batch_max_wait_ms_ = this->opts_->batch_max_wait_ms_;
+	model_config.batch_extra_left_context_ = this->opts_->batch_extra_left_context_;
+	model_config.decodable_opts_ = *(this->nnet3_decodable_opts_);
+	this->model_ = DecoderModelRegistry::Instance().Acquire(model_config);
+
+	// the decoder lives as long as the recognizer and is reset for each segment;
+	// with async finalization a second one decodes while the other finalizes
+	int32 max_queued_frames = this->opts_->use_threaded_decoder_ ? this->opts_->max_queued_frames_ : 0;
+	if (this->decoder_ == NULL) {
+		this->decoder_ = new OnlineNnet3StreamDecoder(*(this->decoder_opts_),
+		                                              *(this->model_->trans_model_),
+		                                              this->model_->looped_info_,
+		                                              this->model_->nnet_batch_scheduler_,
+		                                              *(this->model_->decode_fst_),
+		                                              max_queued_frames,
+		                                              this->search_type_);
 	}
-
-	if (!this->opts_->word_boundary_info_filename_.empty()) {
-	  this->LoadWordBoundaryInfo();
+	if (this->opts_->async_finalization_ && this->finalizing_decoder_ == NULL) {
+		this->finalizing_decoder_ = new OnlineNnet3StreamDecoder(*(this->decoder_opts_),
+		                                                         *(this->model_->trans_model_),
+		                                                         this->model_->looped_info_,
+		                                                         this->model_->nnet_batch_scheduler_,
+		                                                         *(this->model_->decode_fst_),
+		                                                         max_queued_frames,
+		                                                         this->search_type_);
 	}
-
-	if (!this->opts_->model_rspecifier_.empty()) {
-	  this->LoadAcousticModel();
+	if (!this->decoder_->SupportsSilenceWeighting() && this->silence_weighting_config_->Active()) {
+		KALDI_WARN << "Silence weighting needs decoder-type=lattice, not weighting the iVectors";
+		this->silence_weighting_config_->silence_weight = 1.0;
 	}
-
-	if (!this->opts_->fst_rspecifier_.empty()) {
-	  this->LoadFst();
+	if (this->initial_silence_weighting_ == NULL) {
+		this->initial_silence_weighting_ = new OnlineSilenceWeighting(*(this->model_->trans_model_),
+		                                                              *(this->silence_weighting_config_));
+		this->silence_weighting_ = new OnlineSilenceWeighting(*(this->initial_silence_weighting_));
 	}
 
-  if (!this->opts_->lm_fst_rspecifier_.empty()) {
-    LoadLmFst();
+  if ((this->model_->lm_fst_ != NULL) != (this->model_->big_lm_ != NULL)) {
+    KALDI_WARN << "Rescoring needs both lm-fst and big-lm-const-arpa, not rescoring";
   }
 
 	return true;
 }
 
-// load word syms
-// Reference: gst_kaldinnet2onlinedecoder_load_word_syms
-void OnlineDecoder::LoadWordSyms()
-{
-  try {
-	  fst::SymbolTable * new_word_syms = fst::SymbolTable::ReadText(this->opts_->word_syms_filename_);
-	  if (!new_word_syms) {
-		  throw std::runtime_error("Word symbol table not read.");
-	  }
-	
-	  // Delete old objects if needed
-	  if (this->word_syms_) {
-		  delete this->word_syms_;
-	  }
-	
-	  // Replace the symbol table
-	  this->word_syms_ = new_word_syms;
-	} catch (std::runtime_error& e) {
-	  KALDI_WARN << "Error loading the word symbol table: " << this->opts_->word_syms_filename_;
-	}
-}
-
-// load phone syms
-// Reference: gst_kaldinnet2onlinedecoder_load_phone_syms
-void OnlineDecoder::LoadPhoneSyms()
-{
-  try {
-	  fst::SymbolTable * new_phone_syms = fst::SymbolTable::ReadText(this->opts_->phone_syms_filename_);
-	  if (!new_phone_syms) {
-		  throw std::runtime_error("Phone symbol table not read.");
-	  }
-	
-	  // Delete old objects if needed
-	  if (this->phone_syms_) {
-		  delete this->phone_syms_;
-	  }
-
-	  // Replace the symbol table
-	  this->phone_syms_ = new_phone_syms;
-	} catch (std::runtime_error& e) {
-	  KALDI_WARN << "Error loading the phone symbol table: " << this->opts_->phone_syms_filename_;
-	}
-}
-
-// load word boundary info
-// Reference: gst_kaldinnet2onlinedecoder_load_word_boundary_info
-void OnlineDecoder::LoadWordBoundaryInfo()
-{
-  try {
-	  WordBoundaryInfoNewOpts opts; // use default opts
-	  WordBoundaryInfo* new_word_boundary_info = new WordBoundaryInfo(opts, this->opts_->word_boundary_info_filename_);
-
-	  if (!new_word_boundary_info) {
-	    throw std::runtime_error("Word boundary info not read.");
-	  }
-
-	  // Delete old objects if needed
-	  if (this->word_boundary_info_) {
-	    delete this->word_boundary_info_;
-	  }
-
-	  // Replace the word boundary info
-	  this->word_boundary_info_ = new_word_boundary_info;
-  } catch (std::runtime_error& e) {
-	  KALDI_WARN << "Error loading the word boundary info: " << this->opts_->word_boundary_info_filename_;
-	}
-}
-
-// load acoustic model
-// Reference: gst_kaldinnet2onlinedecoder_load_model
-void OnlineDecoder::LoadAcousticModel()
-{
-	
-	if (!this->trans_model_) {
-    this->trans_model_ = new TransitionModel();
+// replace the scores of the small LM in clat by those of the big LM,
+// return false if the lattice has no path left
+// Reference: gst_kaldinnet2onlinedecoder_rescore_big_lm
+bool OnlineDecoder::RescoreLattice(const CompactLattice &clat, CompactLattice *rescored_clat) {
+  Lattice lat;
+  ConvertLattice(clat, &lat);
+  // Before composing with the LM FST, we scale the lattice weights by -1, so
+  // the composition subtracts the old LM scores; the determinization then
+  // keeps the best path through the old LM for each word sequence.
+  fst::ScaleLattice(fst::GraphLatticeScale(-1.0), &lat);
+  fst::ArcSort(&lat, fst::OLabelCompare<LatticeArc>());
+
+  Lattice composed_lat;
+  // the compose cache of the model makes the arc lookups constant instead of
+  // logarithmic in the vocabulary size
+  this->model_->ComposeLmFst(lat, &composed_lat);
+  fst::Invert(&composed_lat); // make it so word labels are on the input.
+
+  CompactLattice determinized_lat;
+  fst::DeterminizeLattice(composed_lat, &determinized_lat);
+  fst::ScaleLattice(fst::GraphLatticeScale(-1.0), &determinized_lat);
+  if (determinized_lat.Start() == fst::kNoStateId) {
+    KALDI_WARN << "Empty lattice after removing the old LM scores (incompatible LM?)";
+    return false;
   }
-  
-  if (!this->am_nnet3_) {
-    this->am_nnet3_ = new nnet3::AmNnetSimple();
-  }
-  
-  // Make the objects read the new models
-  try {
-    bool binary;
-	  Input ki(this->opts_->model_rspecifier_, &binary);
-	  this->trans_model_->Read(ki.Stream(), binary);
-	
-	  this->am_nnet3_->Read(ki.Stream(), binary);
-	  SetBatchnormTestMode(true, &(this->am_nnet3_->GetNnet()));
-	  SetDropoutTestMode(true, &(this->am_nnet3_->GetNnet()));
-	  // this object contains precomputed stuff that is used by all decodable
-	  // objects.  It takes a pointer to am_nnet because if it has iVectors it has
-	  // to modify the nnet to accept iVectors at intervals.
-	  this->decodable_info_nnet3_ = new nnet3::DecodableNnetSimpleLoopedInfo(*(this->nnet3_decodable_opts_), this->am_nnet3_); 
-	} catch (std::runtime_error& e) {
-	  KALDI_WARN << "Error loading the acoustic model: " << this->opts_->model_rspecifier_;
-	}
-}
 
-// load fst
-// Reference: gst_kaldinnet2onlinedecoder_load_fst
-void OnlineDecoder::LoadFst()
-{
-  try {
-	  fst::Fst<fst::StdArc> * new_decode_fst = fst::ReadFstKaldiGeneric(this->opts_->fst_rspecifier_);
-
-    if (!new_decode_fst) {
-	    throw std::runtime_error("FST decoding graph not read.");
-	  }
-	  
-	  // Delete objects if needed
-	  if (this->decode_fst_) {
-	    delete this->decode_fst_;
-	  }
-
-	  // Replace the decoding graph
-	  this->decode_fst_ = new_decode_fst;
-	} catch (std::runtime_error& e) {
-	  KALDI_WARN << "Error loading FST decoding graph: " << this->opts_->fst_rspecifier_;
-	}
-}
-
-// TODO: load lm fst and big lm 
-// Reference: gst_kaldinnet2onlinedecoder_load_lm_fst
-void OnlineDecoder::LoadLmFst() {
-  try {
-	  // Delete objects if needed
-    if (this->lm_fst_) {
-      delete this->lm_fst_;
-    }
-    if (this->lm_compose_cache_) {
-      delete this->lm_compose_cache_;
-    }
-    fst::VectorFst<fst::StdArc> *std_lm_fst = fst::VectorFst<fst::StdArc>::Read(this->opts_->lm_fst_rspecifier_);
-    fst::Project(std_lm_fst, fst::PROJECT_OUTPUT);
-    
-    if (std_lm_fst->Properties(fst::kILabelSorted, true) == 0) {
-      // Make sure LM is sorted on ilabel.
-      fst::ILabelCompare<fst::StdArc> ilabel_comp;
-      fst::ArcSort(std_lm_fst, ilabel_comp);
-    }
-    
-    // mapped_fst is the LM fst interpreted using the LatticeWeight semiring,
-    // with all the cost on the first member of the pair (since it's a graph
-    // weight).
-    int32 num_states_cache = 50000;
-    fst::CacheOptions cache_opts(true, num_states_cache);
-    fst::MapFstOptions mapfst_opts(cache_opts);
-    fst::StdToLatticeMapper<BaseFloat> mapper;
-    this->lm_fst_ = new fst::MapFst<fst::StdArc, LatticeArc,
-        fst::StdToLatticeMapper<BaseFloat> >(*std_lm_fst, mapper, mapfst_opts);
-    delete std_lm_fst;
-    
-    // The next fifteen or so lines are a kind of optimization and
-    // can be ignored if you just want to understand what is going on.
-    // Change the options for TableCompose to match the input
-    // (because it's the arcs of the LM FST we want to do lookup
-    // on).
-    fst::TableComposeOptions compose_opts(fst::TableMatcherOptions(),
-                                          true, fst::SEQUENCE_FILTER,
-                                          fst::MATCH_INPUT);
-
-    // The following is an optimization for the TableCompose
-    // composition: it stores certain tables that enable fast
-    // lookup of arcs during composition.
-    this->lm_compose_cache_ = new fst::TableComposeCache<fst::Fst<LatticeArc> >(compose_opts);
-    
-	} catch (std::runtime_error& e) {
-	  KALDI_WARN << "Error loading LM FST decoding graph: " << this->opts_->lm_fst_rspecifier_;
-	}
+  // add the big LM scores
+  ConstArpaLmDeterministicFst const_arpa_fst(*(this->model_->big_lm_));
+  ComposeCompactLatticeDeterministic(determinized_lat, &const_arpa_fst, rescored_clat);
+  if (rescored_clat->Start() == fst::kNoStateId) {
+    KALDI_WARN << "Empty lattice after rescoring with the big LM";
+    return false;
+  }
+  return true;
 }
 
-// Reference: gst_kaldinnet2onlinedecoder_load_big_lm
-
 // add callback for a signal
 void OnlineDecoder::AddCallBack(DecoderSignal signal, DecoderSignalCallback onSignal)
 {
@@ -307,10 +253,20 @@ void OnlineDecoder::AddCallBack(DecoderSignal signal, DecoderSignalCallback onSi
 	this->onDecoderSignalCallbacks_[signal].push_back(onSignal);
 }
 
+// add callback for the structured full final result
+void OnlineDecoder::AddFullResultCallBack(FullResultCallback onResult)
+{
+	this->onFullResultCallbacks_.push_back(onResult);
+}
+
 // invoke callback for a signal
 void OnlineDecoder::InvokeCallBack(DecoderSignal signal, const char* pszResults)
 {
 	KALDI_ASSERT(this->onDecoderSignalCallbacks_.find(signal) != this->onDecoderSignalCallbacks_.end());
+	if (this->result_dispatcher_ != NULL) {
+		this->result_dispatcher_->Dispatch(id_, signal, pszResults, this->onDecoderSignalCallbacks_[signal]);
+		return;
+	}
 	for(int32 i = 0; i < this->onDecoderSignalCallbacks_[signal].size(); ++ i)
 		this->onDecoderSignalCallbacks_[signal][i](id_, pszResults);
 }
@@ -320,26 +276,21 @@ void OnlineDecoder::InvokeCallBack(DecoderSignal signal, const char* pszResults)
 // Reference: gst_kaldinnet2onlinedecoder_phone_alignment
 std::vector<PhoneAlignmentInfo> OnlineDecoder::GetPhoneAlignment(
 	const std::vector<int32>& alignment, 
-	const CompactLattice &clat) 
+	const CompactLattice &phone_clat) 
 {
 	std::vector<PhoneAlignmentInfo> result;
 	KALDI_VLOG(2) << "Phoneme alignment...";
 	
 	// Output the alignment with the weights
 	std::vector<std::vector<int32> > split;
-	SplitToPhones((*this->trans_model_), alignment, &split);
+	SplitToPhones((*this->model_->trans_model_), alignment, &split);
 	KALDI_VLOG(2) << "Split to phones finished";
 
 	std::vector<int32> phones;
 	for (size_t i = 0; i < split.size(); i++) {
 		KALDI_ASSERT(split[i].size() > 0);
-		phones.push_back(this->trans_model_->TransitionIdToPhone(split[i][0]));
+		phones.push_back(this->model_->trans_model_->TransitionIdToPhone(split[i][0]));
 	}
-	Lattice lat;
-	ConvertLattice(clat, &lat);
-	ConvertLatticeToPhones((*this->trans_model_), &lat);
-	CompactLattice phone_clat;
-	ConvertLattice(lat, &phone_clat);  
 	MinimumBayesRiskOptions mbr_opts;
 	mbr_opts.decode_mbr = false; // we just want confidences
 	mbr_opts.print_silence = false; 
@@ -350,7 +301,7 @@ std::vector<PhoneAlignmentInfo> OnlineDecoder::GetPhoneAlignment(
 	int32 current_start_frame = 0;
 	for (size_t i = 0; i < split.size(); i++) {
 		KALDI_ASSERT(split[i].size() > 0);
-		int32 phone = this->trans_model_->TransitionIdToPhone(split[i][0]);
+		int32 phone = this->model_->trans_model_->TransitionIdToPhone(split[i][0]);
 
 		PhoneAlignmentInfo alignment_info;
 		alignment_info.phone_id = phone;
@@ -378,7 +329,7 @@ std::vector<WordAlignmentInfo> OnlineDecoder::GetWordAlignment(
 	CompactLattice clat;
 	ConvertLattice(lat, &clat);
 	CompactLattice aligned_clat;
-	if (!WordAlignLattice(clat, *(this->trans_model_), *(this->word_boundary_info_), 0, &aligned_clat)) {
+	if (!WordAlignLattice(clat, *(this->model_->trans_model_), *(this->model_->word_boundary_info_), 0, &aligned_clat)) {
 		KALDI_ERR << "Failed to word-align the lattice";
 		return result;
 	}
@@ -422,7 +373,7 @@ void OnlineDecoder::ScaleLattice(CompactLattice &clat) {
 std::string OnlineDecoder::Words2String(const std::vector<int32> &words) {
 	std::stringstream sentence;
 	for (size_t i = 0; i < words.size(); i++) {
-		std::string s = this->word_syms_->Find(words[i]);
+		std::string s = this->model_->word_syms_->Find(words[i]);
 		if (s == "")
 			KALDI_ERR << "Word-id " << words[i] << " not in symbol table.";
 		/*if (i > 0) {
@@ -469,7 +420,7 @@ std::string OnlineDecoder::WordsInHyp2String(const std::vector<PhoneAlignmentInf
   int last_idx = 0;
   for (size_t j = 0; j < word_alignment.size(); j++) {
 	  WordAlignmentInfo alignment_info = word_alignment[j];
-	  std::string word = this->word_syms_->Find(alignment_info.word_id);
+	  std::string word = this->model_->word_syms_->Find(alignment_info.word_id);
     
     sentence << word;
     
@@ -492,6 +443,88 @@ std::string OnlineDecoder::WordsInHyp2String(const std::vector<PhoneAlignmentInf
   }
   return sentence.str();
 }
+// Aligns the hypotheses of a final result on the decoding worker pool, with
+// the thread getting the result taking part. Every participant takes the next
+// hypothesis nobody has taken, so a pool task that starts late finds none
+// left and the result never waits for a queued task; the tasks share this
+// object since they may run after GetNbestResults has returned. Each
+// hypothesis only writes its own NBestResult and error.
+class OnlineDecoder::NbestAlignment {
+ public:
+	NbestAlignment(OnlineDecoder *decoder,
+	               const CompactLattice *clat,
+	               const CompactLattice *phone_clat,
+	               const std::vector<Lattice> *nbest_lats,
+	               const std::vector<std::vector<int32> > *alignments,
+	               const std::vector<std::vector<int32> > *words,
+	               std::vector<NBestResult> *nbest_results,
+	               std::vector<std::string> *errors):
+		decoder_(decoder), clat_(clat), phone_clat_(phone_clat),
+		nbest_lats_(nbest_lats), alignments_(alignments), words_(words),
+		nbest_results_(nbest_results), errors_(errors),
+		num_hyps_(nbest_lats->size()), next_hyp_(0), num_aligned_(0) {}
+
+	// align hypotheses until none is left to take
+	void Run() {
+		while (true) {
+			size_t i = next_hyp_.fetch_add(1);
+			if (i >= num_hyps_)
+				return;
+			try {
+				Align(i);
+			} catch (const std::exception &e) {
+				// KALDI_ERR must not escape the worker
+				(*errors_)[i] = e.what();
+			}
+			std::lock_guard<std::mutex> aligned_locker(aligned_mtx_);
+			if (++num_aligned_ == num_hyps_)
+				aligned_cond_.notify_all();
+		}
+	}
+
+	// wait until all hypotheses are aligned
+	void Wait() {
+		std::unique_lock<std::mutex> aligned_locker(aligned_mtx_);
+		aligned_cond_.wait(aligned_locker, [this] {return this->num_aligned_ == this->num_hyps_; });
+	}
+
+ private:
+	void Align(size_t i) {
+		NBestResult &nbest_result = (*nbest_results_)[i];
+		if (phone_clat_->NumStates() > 0 &&
+		    i < static_cast<size_t>(decoder_->opts_->num_phone_alignment_)) {
+			nbest_result.phone_alignment =
+				decoder_->GetPhoneAlignment((*alignments_)[i], *phone_clat_);
+		}
+		if (decoder_->model_->word_boundary_info_) {
+			MinimumBayesRiskOptions mbr_opts;
+			mbr_opts.decode_mbr = false; // we just want confidences
+			mbr_opts.print_silence = false; 
+			MinimumBayesRisk *mbr = new MinimumBayesRisk(*clat_, (*words_)[i], mbr_opts);
+			std::vector<BaseFloat> confidences = mbr->GetOneBestConfidences();
+			delete mbr;
+			nbest_result.word_alignment = decoder_->GetWordAlignment((*nbest_lats_)[i], confidences);
+		}
+	}
+
+	OnlineDecoder *decoder_;
+	const CompactLattice *clat_;
+	const CompactLattice *phone_clat_;
+	const std::vector<Lattice> *nbest_lats_;
+	const std::vector<std::vector<int32> > *alignments_;
+	const std::vector<std::vector<int32> > *words_;
+	std::vector<NBestResult> *nbest_results_;
+	std::vector<std::string> *errors_;
+
+	size_t num_hyps_;
+	std::atomic<size_t> next_hyp_;
+	std::mutex aligned_mtx_;
+	std::condition_variable aligned_cond_;
+	size_t num_aligned_;
+};
+
+// The phone lattice is built once for all hypotheses, then the hypotheses are
+// aligned in parallel.
 // Reference: gst_kaldinnet2onlinedecoder_nbest_results
 std::vector<NBestResult> OnlineDecoder::GetNbestResults(CompactLattice &clat) {
 
@@ -509,123 +542,205 @@ std::vector<NBestResult> OnlineDecoder::GetNbestResults(CompactLattice &clat) {
 		fst::ConvertNbestToVector(nbest_lat, &nbest_lats);
 	}
 
-	for (size_t i=0; i < nbest_lats.size(); i++) {
-		std::vector<int32> words;
-		std::vector<int32> alignment;
+	size_t num_hyps = nbest_lats.size();
+	std::vector<std::vector<int32> > words(num_hyps), alignments(num_hyps);
+	nbest_results.resize(num_hyps);
+	for (size_t i=0; i < num_hyps; i++) {
 		LatticeWeight weight;
-		GetLinearSymbolSequence(nbest_lats[i], &alignment, &words, &weight);
+		GetLinearSymbolSequence(nbest_lats[i], &alignments[i], &words[i], &weight);
 
-		NBestResult nbest_result;
+		NBestResult &nbest_result = nbest_results[i];
 		nbest_result.likelihood = -(weight.Value1() + weight.Value2());
-		nbest_result.num_frames = alignment.size();
-		for (size_t j=0; j < words.size(); j++) {
+		nbest_result.num_frames = alignments[i].size();
+		for (size_t j=0; j < words[i].size(); j++) {
 			WordInHypothesis word_in_hyp;
-			word_in_hyp.word_id = words[j];
+			word_in_hyp.word_id = words[i][j];
 			nbest_result.words.push_back(word_in_hyp);
 		}
-		if (this->opts_->do_phone_alignment_) {
-			if (i < this->opts_->num_phone_alignment_) {
-				nbest_result.phone_alignment =
-					this->GetPhoneAlignment(alignment, clat);
-			}
+	}
+
+	// the same for every hypothesis, so convert to phones only once
+	CompactLattice phone_clat;
+	if (this->opts_->do_phone_alignment_ && this->opts_->num_phone_alignment_ > 0) {
+		ConvertLatticeToPhones((*this->model_->trans_model_), &lat);
+		ConvertLattice(lat, &phone_clat);
+	}
+
+	if (phone_clat.NumStates() > 0 || this->model_->word_boundary_info_) {
+		std::vector<std::string> errors(num_hyps);
+		std::shared_ptr<NbestAlignment> alignment(new NbestAlignment(
+			this, &clat, &phone_clat, &nbest_lats, &alignments, &words, &nbest_results, &errors));
+		int32 num_threads = std::min<int32>(this->opts_->num_nbest_threads_, num_hyps);
+		if (num_threads > 1) {
+			DecoderWorkerPool &pool = DecoderWorkerPool::Instance(this->opts_->num_workers_);
+			for (int32 i = 1; i < num_threads; i++)
+				pool.Submit(std::bind(&NbestAlignment::Run, alignment));
 		}
-		if (this->word_boundary_info_) {
-			MinimumBayesRiskOptions mbr_opts;
-			mbr_opts.decode_mbr = false; // we just want confidences
-			mbr_opts.print_silence = false; 
-			MinimumBayesRisk *mbr = new MinimumBayesRisk(clat, words, mbr_opts);
-			std::vector<BaseFloat> confidences = mbr->GetOneBestConfidences();
-			delete mbr;
-			nbest_result.word_alignment = this->GetWordAlignment(nbest_lats[i], confidences);
+		alignment->Run();
+		alignment->Wait();
+		for (size_t i = 0; i < num_hyps; i++) {
+			if (!errors[i].empty())
+				KALDI_ERR << "Failed to align hypothesis " << i << ": " << errors[i];
 		}
-		nbest_results.push_back(nbest_result);
 	}
 	return nbest_results;
 }
 
 // Reference: gst_kaldinnet2onlinedecoder_full_final_result_to_json
-std::string OnlineDecoder::FullFinalResult2Json(
+const std::string &OnlineDecoder::FullFinalResult2Json(
 	const FullFinalResult &full_final_result) {
 
-	json_t *root = json_object();
-	json_t *result_json_object = json_object();
-	json_object_set_new(root, "speaker", json_string(full_final_result.spkr.c_str()));
-	json_object_set_new( root, "result", result_json_object);
-	json_object_set_new( result_json_object, "final", json_true());
+	ScopedStageTimer timer(&(this->stage_timers_), kStageJson);
+	JsonWriter &json = this->json_writer_;
+	json.Clear();
+	json.BeginObject();
+	json.Key("speaker");
+	json.String(full_final_result.spkr);
+	json.Key("result");
+	json.BeginObject();
+	json.Key("final");
+	json.Bool(true);
+
+	if (full_final_result.nbest_results.size() == 0) {
+		json.EndObject();
+		json.EndObject();
+		return json.Str();
+	}
 
-	if (full_final_result.nbest_results.size() > 0) {
-		BaseFloat frame_shift = this->feature_info_->FrameShiftInSeconds();
-		frame_shift *= this->nnet3_decodable_opts_->frame_subsampling_factor;
-		json_object_set_new(root, "segment-start",  json_real(this->segment_start_time_));
-		json_object_set_new(root, "segment-length",  json_real(full_final_result.nbest_results[0].num_frames * frame_shift));
-		json_object_set_new(root, "total-length",  json_real(this->total_time_decoded_));
-		json_t *nbest_json_arr = json_array();
-		for(std::vector<NBestResult>::const_iterator it = full_final_result.nbest_results.begin();
-				it != full_final_result.nbest_results.end(); ++it) {
-			NBestResult nbest_result = *it;
-			json_t *nbest_result_json_object = json_object();
-			json_object_set_new(nbest_result_json_object, "transcript",
-								json_string(this->WordsInHyp2String(nbest_result.words).c_str()));
-			json_object_set_new(nbest_result_json_object, "likelihood",  json_real(nbest_result.likelihood));
-			json_array_append( nbest_json_arr, nbest_result_json_object );
-		  if (nbest_result.phone_alignment.size() > 0) {
-			  if (strcmp(this->opts_->phone_syms_filename_.c_str(), "") == 0) {
-				  KALDI_ERR << "Phoneme symbol table filename (phone-syms) must be set to output phone alignment.";
-			  } else if (this->phone_syms_ == NULL) {
-				  KALDI_ERR << "Phoneme symbol table wasn't loaded correctly. Not outputting alignment.";
-			  } else {
-				  json_t *phone_alignment_json_arr = json_array();
-				  for (size_t j = 0; j < nbest_result.phone_alignment.size(); j++) {
-					  PhoneAlignmentInfo alignment_info = nbest_result.phone_alignment[j];
-					  json_t *alignment_info_json_object = json_object();
-					  std::string phone = this->phone_syms_->Find(alignment_info.phone_id);
-					  json_object_set_new(alignment_info_json_object, "phone",
-										  json_string(phone.c_str()));
-					  json_object_set_new(alignment_info_json_object, "start",
-										  json_real(alignment_info.start_frame * frame_shift));
-					  json_object_set_new(alignment_info_json_object, "length",
-										  json_real(alignment_info.length_in_frames * frame_shift));
-					  json_object_set_new(alignment_info_json_object, "confidence",
-										  json_real(alignment_info.confidence));
-					  json_array_append(phone_alignment_json_arr, alignment_info_json_object);
-				  }
-				  json_object_set_new(nbest_result_json_object, "phone-alignment", phone_alignment_json_arr);
+	BaseFloat frame_shift = this->feature_info_->FrameShiftInSeconds();
+	frame_shift *= this->nnet3_decodable_opts_->frame_subsampling_factor;
+	json.Key("hypotheses");
+	json.BeginArray();
+	for(std::vector<NBestResult>::const_iterator it = full_final_result.nbest_results.begin();
+			it != full_final_result.nbest_results.end(); ++it) {
+		const NBestResult &nbest_result = *it;
+		json.BeginObject();
+		json.Key("transcript");
+		json.String(this->WordsInHyp2String(nbest_result.words));
+		json.Key("likelihood");
+		json.Real(nbest_result.likelihood);
+	  if (nbest_result.phone_alignment.size() > 0) {
+		  if (strcmp(this->opts_->phone_syms_filename_.c_str(), "") == 0) {
+			  KALDI_ERR << "Phoneme symbol table filename (phone-syms) must be set to output phone alignment.";
+		  } else if (this->model_->phone_syms_ == NULL) {
+			  KALDI_ERR << "Phoneme symbol table wasn't loaded correctly. Not outputting alignment.";
+		  } else {
+			  json.Key("phone-alignment");
+			  json.BeginArray();
+			  for (size_t j = 0; j < nbest_result.phone_alignment.size(); j++) {
+				  const PhoneAlignmentInfo &alignment_info = nbest_result.phone_alignment[j];
+				  json.BeginObject();
+				  json.Key("phone");
+				  json.String(this->model_->phone_syms_->Find(alignment_info.phone_id));
+				  json.Key("start");
+				  json.Real(alignment_info.start_frame * frame_shift);
+				  json.Key("length");
+				  json.Real(alignment_info.length_in_frames * frame_shift);
+				  json.Key("confidence");
+				  json.Real(alignment_info.confidence);
+				  json.EndObject();
 			  }
+			  json.EndArray();
 		  }
-		  if (nbest_result.word_alignment.size() > 0) {
-			  json_t *word_alignment_json_arr = json_array();
-			  for (size_t j = 0; j < nbest_result.word_alignment.size(); j++) {
-				  WordAlignmentInfo alignment_info = nbest_result.word_alignment[j];
-				  json_t *alignment_info_json_object = json_object();
-				  std::string word = this->word_syms_->Find(alignment_info.word_id);
-				  json_object_set_new(alignment_info_json_object, "word",
-									  json_string(word.c_str()));
-				  json_object_set_new(alignment_info_json_object, "start",
-									  json_real(alignment_info.start_frame * frame_shift));
-				  json_object_set_new(alignment_info_json_object, "length",
-									  json_real(alignment_info.length_in_frames * frame_shift));
-				  json_object_set_new(alignment_info_json_object, "confidence",
-									  json_real(alignment_info.confidence));
-				  json_array_append(word_alignment_json_arr, alignment_info_json_object);
-			  }
-			  json_object_set_new(nbest_result_json_object, "word-alignment", word_alignment_json_arr);
+	  }
+	  if (nbest_result.word_alignment.size() > 0) {
+		  json.Key("word-alignment");
+		  json.BeginArray();
+		  for (size_t j = 0; j < nbest_result.word_alignment.size(); j++) {
+			  const WordAlignmentInfo &alignment_info = nbest_result.word_alignment[j];
+			  json.BeginObject();
+			  json.Key("word");
+			  json.String(this->model_->word_syms_->Find(alignment_info.word_id));
+			  json.Key("start");
+			  json.Real(alignment_info.start_frame * frame_shift);
+			  json.Key("length");
+			  json.Real(alignment_info.length_in_frames * frame_shift);
+			  json.Key("confidence");
+			  json.Real(alignment_info.confidence);
+			  json.EndObject();
 		  }
-		}
-
-		json_object_set_new(result_json_object, "hypotheses", nbest_json_arr);
+		  json.EndArray();
+	  }
+		json.EndObject();
 	}
+	json.EndArray();
+	json.EndObject();
+
+	// same key order as the jansson tree this replaced
+	json.Key("segment-start");
+	json.Real(full_final_result.segment_start_time);
+	json.Key("segment-length");
+	json.Real(full_final_result.nbest_results[0].num_frames * frame_shift);
+	json.Key("total-length");
+	json.Real(full_final_result.total_time_decoded);
+	json.EndObject();
+	return json.Str();
+}
 
-	char *ret_strings = json_dumps(root, JSON_REAL_PRECISION(6));
+// the same content as FullFinalResult2Json
+void OnlineDecoder::FullFinalResult2Struct(const FullFinalResult &full_final_result,
+                                           RecogResultStorage *storage) {
+	storage->Clear();
+	if (full_final_result.nbest_results.size() == 0) {
+		storage->SetSegment(full_final_result.spkr, 0.0, 0.0, 0.0);
+		return;
+	}
+	BaseFloat frame_shift = this->feature_info_->FrameShiftInSeconds();
+	frame_shift *= this->nnet3_decodable_opts_->frame_subsampling_factor;
+	storage->SetSegment(full_final_result.spkr, full_final_result.segment_start_time,
+	                    full_final_result.nbest_results[0].num_frames * frame_shift,
+	                    full_final_result.total_time_decoded);
+	for (size_t i = 0; i < full_final_result.nbest_results.size(); i++) {
+		const NBestResult &nbest_result = full_final_result.nbest_results[i];
+		storage->AddHypothesis(this->WordsInHyp2String(nbest_result.words),
+		                       nbest_result.likelihood);
+		if (nbest_result.word_alignment.size() > 0) {
+			for (size_t j = 0; j < nbest_result.word_alignment.size(); j++) {
+				const WordAlignmentInfo &alignment_info = nbest_result.word_alignment[j];
+				storage->AddWord(alignment_info.word_id,
+				                 this->model_->word_syms_->Find(alignment_info.word_id),
+				                 alignment_info.start_frame * frame_shift,
+				                 alignment_info.length_in_frames * frame_shift,
+				                 alignment_info.confidence);
+			}
+		} else {
+			// no word-boundary-file, so only the words are known
+			for (size_t j = 0; j < nbest_result.words.size(); j++) {
+				int32 word_id = nbest_result.words[j].word_id;
+				storage->AddWord(word_id, this->model_->word_syms_->Find(word_id), -1.0, -1.0, -1.0);
+			}
+		}
+		if (nbest_result.phone_alignment.size() > 0 && this->model_->phone_syms_ != NULL) {
+			for (size_t j = 0; j < nbest_result.phone_alignment.size(); j++) {
+				const PhoneAlignmentInfo &alignment_info = nbest_result.phone_alignment[j];
+				storage->AddPhone(alignment_info.phone_id,
+				                  this->model_->phone_syms_->Find(alignment_info.phone_id),
+				                  alignment_info.start_frame * frame_shift,
+				                  alignment_info.length_in_frames * frame_shift,
+				                  alignment_info.confidence);
+			}
+		}
+	}
+}
 
-	json_decref( root );
-	std::string result;
-	result = ret_strings;
-	return result;
+void OnlineDecoder::InvokeFullResultCallBack(const FullFinalResult &full_final_result) {
+	// a result still queued in the dispatcher keeps its storage until delivered
+	std::shared_ptr<RecogResultStorage> storage = this->full_result_storages_->Get();
+	this->FullFinalResult2Struct(full_final_result, storage.get());
+	if (this->result_dispatcher_ != NULL) {
+		this->result_dispatcher_->DispatchFullResult(id_, storage,
+		                                             this->onFullResultCallbacks_);
+		return;
+	}
+	const RecogResult *result = storage->Finish();
+	for (size_t i = 0; i < this->onFullResultCallbacks_.size(); i++)
+		this->onFullResultCallbacks_[i](id_, result);
 }
 
 // Reference: gst_kaldinnet2onlinedecoder_final_result
 void OnlineDecoder::GenerateFinalResult(
-	CompactLattice &clat, int32 *num_words, string spkr) {
+	CompactLattice &clat, int32 *num_words, string spkr,
+	float segment_start_time, float total_time_decoded) {
 	if (clat.NumStates() == 0) {
 		KALDI_WARN << "Empty lattice.";
 		return;
@@ -636,7 +751,12 @@ void OnlineDecoder::GenerateFinalResult(
 	FullFinalResult full_final_result;
 	KALDI_VLOG(2) << "Decoding n-best results";
 	full_final_result.spkr = spkr;
-	full_final_result.nbest_results = this->GetNbestResults(clat);
+	full_final_result.segment_start_time = segment_start_time;
+	full_final_result.total_time_decoded = total_time_decoded;
+	{
+		ScopedStageTimer timer(&(this->stage_timers_), kStageNbest);
+		full_final_result.nbest_results = this->GetNbestResults(clat);
+	}
 
 	if (full_final_result.nbest_results.size() > 0) {
 		//std::string best_transcript = this->WordsInHyp2String(full_final_result.nbest_results[0].words);
@@ -651,143 +771,482 @@ void OnlineDecoder::GenerateFinalResult(
 
 		if (hyp_length > 0) {
 			// Invoke the FINAL_RESULT_SIGNAL
+			this->last_final_time_ns_ = SteadyTimeNs();
 			this->InvokeCallBack(FINAL_RESULT_SIGNAL, best_transcript.c_str());
-			// Invoke the FULL_FINAL_RESULT_SIGNAL
-			std::string full_final_result_as_json =	this->FullFinalResult2Json(full_final_result);
-			KALDI_VLOG(2) << "Final JSON: " << full_final_result_as_json.c_str();
-			this->InvokeCallBack(FULL_FINAL_RESULT_SIGNAL, full_final_result_as_json.c_str());
+			// Invoke the FULL_FINAL_RESULT_SIGNAL, the JSON is only made for its callbacks
+			if (!this->onDecoderSignalCallbacks_[FULL_FINAL_RESULT_SIGNAL].empty()) {
+				const std::string &full_final_result_as_json = this->FullFinalResult2Json(full_final_result);
+				KALDI_VLOG(2) << "Final JSON: " << full_final_result_as_json.c_str();
+				this->InvokeCallBack(FULL_FINAL_RESULT_SIGNAL, full_final_result_as_json.c_str());
+			}
+			if (!this->onFullResultCallbacks_.empty())
+				this->InvokeFullResultCallBack(full_final_result);
 		}
 	}
 }
 
 // Reference: gst_kaldinnet2onlinedecoder_partial_result
-void OnlineDecoder::GeneratePartialResult(const Lattice lat) {
-	std::vector<int32> words;
-	std::vector<int32> alignment;
-	LatticeWeight weight;
-	GetLinearSymbolSequence(lat, &alignment, &words, &weight);
-	std::string transcript = this->Words2String(words);
+// only the words after the first num_unchanged are looked up and appended,
+// the rest of the transcript is kept from the previous partial result
+void OnlineDecoder::GeneratePartialResult(const std::vector<int32> &words, int32 num_unchanged) {
+	num_unchanged = std::min<int32>(num_unchanged, this->partial_word_ends_.size());
+	this->partial_word_ends_.resize(num_unchanged);
+	this->partial_transcript_.resize(num_unchanged > 0 ? this->partial_word_ends_.back() : 0);
+	for (size_t i = num_unchanged; i < words.size(); i++) {
+		std::string s = this->model_->word_syms_->Find(words[i]);
+		if (s == "")
+			KALDI_ERR << "Word-id " << words[i] << " not in symbol table.";
+		this->partial_transcript_ += s;
+		this->partial_word_ends_.push_back(this->partial_transcript_.length());
+	}
+	const std::string &transcript = this->partial_transcript_;
 	KALDI_VLOG(2) << "Partial: " << transcript.c_str();
 	if (transcript.length() > 0) {
 		// Invoke the PARTIAL_RESULT_SIGNAL signal
+		this->last_partial_time_ns_ = SteadyTimeNs();
 		this->InvokeCallBack(PARTIAL_RESULT_SIGNAL, transcript.c_str()); 
 	}
 }
 
 // Reference: gst_kaldinnet2onlinedecoder_nnet3_unthreaded_decode_segment
 void OnlineDecoder::DecodeSegment(AudioState &audio_state, int32 chunk_length, BaseFloat traceback_period_secs) {
-  OnlineNnet2FeaturePipeline feature_pipeline(*(this->feature_info_));
-  
-  feature_pipeline.SetAdaptationState(*(this->adaptation_state_));
-  
-  OnlineSilenceWeighting silence_weighting(*(this->trans_model_),
-                                           *(this->silence_weighting_config_));
-            
-  SingleUtteranceNnet3Decoder decoder(*(this->decoder_opts_),
-                                      *(this->trans_model_), 
-                                      *(this->decodable_info_nnet3_),
-                                      *(this->decode_fst_),
-                                      &feature_pipeline);
-
-  Vector<BaseFloat> wave_part(chunk_length);
-  std::vector<std::pair<int32, BaseFloat> > delta_weights;
-  KALDI_VLOG(2) << "Reading audio in " << wave_part.Dim() << " sample chunks...";
-  BaseFloat last_traceback = 0.0;
-  BaseFloat num_seconds_decoded = 0.0;
-  string spkr;
-  while (true) {
-	  audio_state = this->audio_source_->ReadData(&wave_part, spkr);
-	  // check if any data is read
-	  if (spkr.empty())
-	  {
-		  // if no data is read, that audio state should be SpkrEnd or AudioEnd
-		  KALDI_ASSERT(audio_state == AudioState::SpkrEnd || audio_state == AudioState::AudioEnd);
-		  // skip starting empty speaker end change, 
-		  // this occurs when last segment is the end of an old spk and we start a new spk in this segment
-		  if (num_seconds_decoded == 0 && audio_state == AudioState::SpkrEnd)
-			  continue;
-		  else
-			  break; // otherwise, exit and end this segment decoding
-	  }
-	  // std::cout << "Recieved data, decoding ..." << std::endl;
-	  // if some data is read, proceed to decoding it
-	  if (this->sample_rate_ > this->feature_info_->mfcc_opts.frame_opts.samp_freq) {
-	    std::cout << "WARNING: the sample rate of audio is not match that of models, " 
-	      << "downsample will take lots of time." << std::endl;
-	    Vector<BaseFloat> downsampled_wave(wave_part);
-      DownsampleWaveForm(this->sample_rate_, wave_part,
-                         this->feature_info_->mfcc_opts.frame_opts.samp_freq, &downsampled_wave);
-      feature_pipeline.AcceptWaveform(this->feature_info_->mfcc_opts.frame_opts.samp_freq, downsampled_wave);
-    } else {
-      feature_pipeline.AcceptWaveform(this->sample_rate_, wave_part);
-    }
-	  // if the audio state is SpkrEnd or AudioEnd, it means an end of the current segment, so let's finish feature input
-    if (audio_state == AudioState::SpkrEnd || audio_state == AudioState::AudioEnd) {
-      feature_pipeline.InputFinished();
+  if (this->decoder_->Pipelined()) {
+    this->DecodeSegmentPipelined(audio_state, chunk_length, traceback_period_secs);
+    return;
+  }
+  this->BeginSegment();
+  while (!this->DecodeChunk(audio_state, chunk_length, traceback_period_secs));
+  this->EndSegment();
+}
+
+// create the feature pipeline for a new segment and reset the decoder and the
+// silence weighting on it; Kaldi's feature classes have no reset, so the
+// pipeline is the only part built again
+void OnlineDecoder::BeginSegment() {
+  this->feature_pipeline_ = new OnlineStreamFeaturePipeline(*(this->feature_info_),
+                                                           this->opts_->block_features_);
+  this->feature_pipeline_->SetAdaptationState(*(this->adaptation_state_));
+
+  this->ResetSilenceWeighting();
+
+  this->decoder_->InitDecoding(this->feature_pipeline_);
+  this->last_traceback_ = 0.0;
+  this->partial_transcript_.clear();
+  this->partial_word_ends_.clear();
+  this->num_seconds_decoded_ = 0.0;
+  this->segment_spkr_ = "";
+  this->segment_active_ = true;
+}
+
+// the backlog only grows until this thread reads it, so a chunk no longer
+// than the backlog is read without waiting
+int32 OnlineDecoder::NextChunkLength(int32 chunk_length) const {
+  int32 max_chunk_length = int32(this->sample_rate_ * this->opts_->max_chunk_length_in_secs_);
+  if (max_chunk_length <= chunk_length || chunk_length <= 0)
+    return chunk_length;
+  int32 num_chunks = this->audio_source_->NumSamplesReady() / chunk_length;
+  if (num_chunks <= 1)
+    return chunk_length;
+  // whole chunks, so that the chunks of a stream catching up stay aligned
+  // with those of a live one
+  return std::min(num_chunks * chunk_length, max_chunk_length / chunk_length * chunk_length);
+}
+
+// read and decode one chunk of audio, return true if the segment has ended
+bool OnlineDecoder::DecodeChunk(AudioState &audio_state, int32 chunk_length, BaseFloat traceback_period_secs) {
+  OnlineStreamFeaturePipeline &feature_pipeline = *(this->feature_pipeline_);
+  OnlineNnet3StreamDecoder &decoder = *(this->decoder_);
+  // ReadData shrinks the vector at the end of a speaker
+  this->wave_part_.Resize(this->NextChunkLength(chunk_length), kUndefined);
+  {
+    ScopedStageTimer timer(&(this->stage_timers_), kStageReadData);
+    audio_state = this->audio_source_->ReadData(&(this->wave_part_), this->segment_spkr_);
+  }
+  // check if any data is read
+  if (this->segment_spkr_.empty())
+  {
+	  // if no data is read, that audio state should be SpkrEnd or AudioEnd
+	  KALDI_ASSERT(audio_state == AudioState::SpkrEnd || audio_state == AudioState::AudioEnd);
+	  // skip starting empty speaker end change, 
+	  // this occurs when last segment is the end of an old spk and we start a new spk in this segment
+	  if (this->num_seconds_decoded_ == 0 && audio_state == AudioState::SpkrEnd)
+		  return false;
+	  else
+		  return true; // otherwise, exit and end this segment decoding
+  }
+  // std::cout << "Recieved data, decoding ..." << std::endl;
+  // if some data is read, proceed to decoding it
+  int64 decoding_start_ns = SteadyTimeNs();
+  this->AcceptWave(this->wave_part_, audio_state != AudioState::SpkrContinue);
+  // if the audio state is SpkrEnd or AudioEnd, it means an end of the current segment, so let's finish feature input
+  if (audio_state == AudioState::SpkrEnd || audio_state == AudioState::AudioEnd) {
+    feature_pipeline.InputFinished();
+  }
+  if (this->silence_weighting_->Active() && 
+      feature_pipeline.IvectorFeature() != NULL) {
+    ScopedStageTimer timer(&(this->stage_timers_), kStageSilenceWeighting);
+    decoder.ComputeSilenceTraceback(this->silence_weighting_);
+    this->silence_weighting_->GetDeltaWeights(feature_pipeline.IvectorFeature()->NumFramesReady(), 
+                                              &(this->delta_weights_));
+    feature_pipeline.IvectorFeature()->UpdateFrameWeights(this->delta_weights_);
+  }
+  {
+    ScopedStageTimer timer(&(this->stage_timers_), kStageAdvanceDecoding);
+    decoder.AdvanceDecoding();
+  }
+  KALDI_VLOG(2) <<  decoder.NumFramesDecoded() << " frames decoded";
+  BaseFloat num_seconds = (BaseFloat) this->wave_part_.Dim() / this->sample_rate_;
+  this->num_seconds_decoded_ += num_seconds;
+  this->total_time_decoded_ += num_seconds;
+  this->stats_frames_decoded_ = this->frames_decoded_before_segment_ + decoder.NumFramesDecoded();
+  this->stats_active_tokens_ = decoder.NumActiveTokens();
+  this->UpdateStats((SteadyTimeNs() - decoding_start_ns) * 1.0e-9, num_seconds);
+  KALDI_VLOG(2) << "Total amount of audio processed: " << this->total_time_decoded_ << " seconds";
+
+  // if this is the end of a speaker or audio, exit decoding current segment
+  if (audio_state == AudioState::SpkrEnd) {
+	  KALDI_VLOG(2) << "Speaker change detected!";
+    return true;
+  }
+  if (audio_state == AudioState::AudioEnd) {
+	  KALDI_VLOG(2) << "Audio end detected!";
+	  return true;
+  }
+  // if an end pointing is detected, also exit decoding current segment
+  if (this->opts_->do_endpointing_
+      && (decoder.NumFramesDecoded() > 0)
+      && decoder.EndpointDetected(*(this->endpoint_config_))) {
+    KALDI_VLOG(2) << "Endpoint detected!";
+    //std::cout << this->total_time_decoded_ << std::endl;
+    return true;
+  }
+  this->MaybeGeneratePartialResult(traceback_period_secs);
+  return false;
+}
+
+// flush the resampler at the end of a speaker, so the next one starts with a
+// clean filter
+const VectorBase<BaseFloat> &OnlineDecoder::AcceptWave(const VectorBase<BaseFloat> &wave, bool flush) {
+  if (this->resampler_ != NULL) {
+    {
+      ScopedStageTimer timer(&(this->stage_timers_), kStageResample);
+      this->resampler_->Resample(wave, flush, &(this->resampled_wave_));
     }
-    if (silence_weighting.Active() && 
-        feature_pipeline.IvectorFeature() != NULL) {
-      silence_weighting.ComputeCurrentTraceback(decoder.Decoder());
-      silence_weighting.GetDeltaWeights(feature_pipeline.IvectorFeature()->NumFramesReady(), 
-                                        &delta_weights);
-      feature_pipeline.IvectorFeature()->UpdateFrameWeights(delta_weights);
+    ScopedStageTimer timer(&(this->stage_timers_), kStageAcceptWaveform);
+    this->feature_pipeline_->AcceptWaveform(this->resampler_->GetOutputSamplingRate(), this->resampled_wave_);
+    return this->resampled_wave_;
+  }
+  ScopedStageTimer timer(&(this->stage_timers_), kStageAcceptWaveform);
+  this->feature_pipeline_->AcceptWaveform(this->sample_rate_, wave);
+  return wave;
+}
+
+void OnlineDecoder::MaybeGeneratePartialResult(BaseFloat traceback_period_secs) {
+  OnlineNnet3StreamDecoder &decoder = *(this->decoder_);
+  // with async finalization, not before the final result of the previous
+  // segment
+  if ((this->num_seconds_decoded_ - this->last_traceback_ > traceback_period_secs)
+      && (decoder.NumFramesDecoded() > 0) && !this->finalizing_) {
+    if (opts_->do_partial_) {
+      ScopedStageTimer timer(&(this->stage_timers_), kStagePartialResult);
+      int32 num_unchanged = 0;
+      const std::vector<int32> &words = decoder.TraceBackPartial(&num_unchanged);
+      this->GeneratePartialResult(words, num_unchanged);
     }
-    decoder.AdvanceDecoding();
-    KALDI_VLOG(2) <<  decoder.NumFramesDecoded() << " frames decoded";
-	  BaseFloat num_seconds = (BaseFloat) wave_part.Dim() / this->sample_rate_;
-    num_seconds_decoded += num_seconds;
-    this->total_time_decoded_ += num_seconds;
-    KALDI_VLOG(2) << "Total amount of audio processed: " << this->total_time_decoded_ << " seconds";
+    this->last_traceback_ += traceback_period_secs;
+  }
+}
 
-	  // if this is the end of a speaker or audio, exit decoding current segment
-    if (audio_state == AudioState::SpkrEnd) {
-		  KALDI_VLOG(2) << "Speaker change detected!";
-      break;
+// Reference: gst_kaldinnet2onlinedecoder_threaded_decode_segment
+void OnlineDecoder::DecodeSegmentPipelined(AudioState &audio_state, int32 chunk_length,
+                                           BaseFloat traceback_period_secs) {
+  OnlineNnet3StreamDecoder &decoder = *(this->decoder_);
+  this->BeginSegment();
+  this->pipeline_frames_decoded_ = 0;
+  this->segment_wave_.clear();
+  this->segment_wave_offset_ = 0;
+  this->feature_thread_ = new std::thread(&OnlineDecoder::FeedSegment, this, chunk_length);
+
+  BaseFloat frame_shift = decoder.FrameShiftInSeconds();
+  bool endpoint_detected = false;
+  while (decoder.WaitForFrames()) {
+    int64 decoding_start_ns = SteadyTimeNs();
+    {
+      ScopedStageTimer timer(&(this->stage_timers_), kStageAdvanceDecoding);
+      decoder.AdvanceDecoding();
     }
-	  if (audio_state == AudioState::AudioEnd) {
-		  KALDI_VLOG(2) << "Audio end detected!";
-		  break;
-	  }
-	  // if an end pointing is detected, also exit decoding current segment
-    if (this->opts_->do_endpointing_
-        && (decoder.NumFramesDecoded() > 0)
-        && decoder.EndpointDetected(*(this->endpoint_config_))) {
+    int32 num_frames_decoded = decoder.NumFramesDecoded();
+    this->pipeline_frames_decoded_ = num_frames_decoded;
+    if (this->silence_weighting_->Active() &&
+        this->feature_pipeline_->IvectorFeature() != NULL) {
+      ScopedStageTimer timer(&(this->stage_timers_), kStageSilenceWeighting);
+      std::lock_guard<std::mutex> silence_weighting_locker(this->silence_weighting_mtx_);
+      decoder.ComputeSilenceTraceback(this->silence_weighting_);
+    }
+    BaseFloat num_seconds = num_frames_decoded * frame_shift - this->num_seconds_decoded_;
+    this->num_seconds_decoded_ += num_seconds;
+    this->total_time_decoded_ += num_seconds;
+    this->stats_frames_decoded_ = this->frames_decoded_before_segment_ + num_frames_decoded;
+    this->stats_active_tokens_ = decoder.NumActiveTokens();
+    // the pipeline goes as fast as the slower of its threads
+    int64 decoding_ns = std::max<int64>(SteadyTimeNs() - decoding_start_ns,
+                                        this->pipeline_busy_ns_.exchange(0));
+    this->UpdateStats(decoding_ns * 1.0e-9, num_seconds);
+
+    if (this->opts_->do_endpointing_ && decoder.EndpointDetected(*(this->endpoint_config_))) {
       KALDI_VLOG(2) << "Endpoint detected!";
-      //std::cout << this->total_time_decoded_ << std::endl;
+      endpoint_detected = true;
       break;
     }
-	  // generate partial result every traceback_period_secs
-    if ((num_seconds_decoded - last_traceback > traceback_period_secs)
-        && (decoder.NumFramesDecoded() > 0)) {
-      if (opts_->do_partial_) {
-        Lattice lat;
-        decoder.GetBestPath(false, &lat);
-        this->GeneratePartialResult(lat);
+    this->MaybeGeneratePartialResult(traceback_period_secs);
+  }
+
+  if (endpoint_detected) {
+    // the feature thread may be waiting for audio rather than for the queue
+    decoder.CancelPipeline();
+    this->audio_source_->CancelRead();
+  }
+  this->feature_thread_->join();
+  delete this->feature_thread_;
+  this->feature_thread_ = NULL;
+  this->audio_source_->ResumeRead();
+  audio_state = this->feature_audio_state_;
+
+  if (endpoint_detected) {
+    // the audio after the endpoint starts the next segment, as in
+    // SingleUtteranceNnet2DecoderThreaded::GetRemainingWaveform
+    int64 num_samples = this->segment_wave_.size();
+    int64 first_sample = static_cast<int64>(decoder.NumFramesDecoded() * frame_shift *
+                                            this->WaveSampleRate()) - this->segment_wave_offset_;
+    first_sample = std::min(std::max<int64>(first_sample, 0), num_samples);
+    if (first_sample < num_samples) {
+      this->carried_wave_.Resize(num_samples - first_sample, kUndefined);
+      std::copy(this->segment_wave_.begin() + first_sample, this->segment_wave_.end(),
+                this->carried_wave_.Data());
+      this->carried_spkr_ = this->segment_spkr_;
+      this->carried_audio_state_ = audio_state;
+      // the end of the speaker or audio comes after the carried audio
+      audio_state = AudioState::SpkrContinue;
+    }
+  }
+  this->segment_wave_.clear();
+  this->EndSegment();
+}
+
+// the feature thread of the threaded decoder, reads the audio of a segment
+// and queues its acoustic scores for DecodeSegmentPipelined
+// Reference: SingleUtteranceNnet2DecoderThreaded::RunNnetEvaluationInternal
+void OnlineDecoder::FeedSegment(int32 chunk_length) {
+  OnlineStreamFeaturePipeline &feature_pipeline = *(this->feature_pipeline_);
+  BaseFloat frame_shift = this->decoder_->FrameShiftInSeconds();
+  BaseFloat wave_rate = this->WaveSampleRate();
+  AudioState audio_state = AudioState::SpkrContinue;
+  bool has_audio = false;
+  if (this->carried_wave_.Dim() > 0) {
+    // already resampled, and the end of its speaker may have been read too
+    this->segment_spkr_ = this->carried_spkr_;
+    feature_pipeline.AcceptWaveform(wave_rate, this->carried_wave_);
+    this->segment_wave_.assign(this->carried_wave_.Data(),
+                               this->carried_wave_.Data() + this->carried_wave_.Dim());
+    audio_state = this->carried_audio_state_;
+    this->carried_wave_.Resize(0);
+    has_audio = true;
+  }
+
+  while (audio_state == AudioState::SpkrContinue) {
+    this->wave_part_.Resize(this->NextChunkLength(chunk_length), kUndefined);
+    {
+      ScopedStageTimer timer(&(this->stage_timers_), kStageReadData);
+      audio_state = this->audio_source_->ReadData(&(this->wave_part_), this->segment_spkr_);
+    }
+    if (this->wave_part_.Dim() == 0 && this->audio_source_->ReadCancelled()) {
+      // cancelled at an endpoint while waiting for audio
+      this->feature_audio_state_ = audio_state;
+      return;
+    }
+    if (this->segment_spkr_.empty()) {
+      KALDI_ASSERT(audio_state == AudioState::SpkrEnd || audio_state == AudioState::AudioEnd);
+      // skip an empty speaker end at the start of the segment, as DecodeChunk does
+      if (!has_audio && audio_state == AudioState::SpkrEnd) {
+        audio_state = AudioState::SpkrContinue;
+        continue;
       }
-      last_traceback += traceback_period_secs;
-      
-      //clock_t ended_s = clock();
-      //std::cout << float (ended_s - start_ss) / CLOCKS_PER_SEC - this->total_time_decoded_ << std::endl;
+      break;
+    }
+    has_audio = true;
+    int64 start_ns = SteadyTimeNs();
+    const VectorBase<BaseFloat> &wave = this->AcceptWave(this->wave_part_,
+                                                         audio_state != AudioState::SpkrContinue);
+    this->segment_wave_.insert(this->segment_wave_.end(), wave.Data(), wave.Data() + wave.Dim());
+    // keep only the audio that may still be carried to the next segment
+    int64 num_samples_decoded = static_cast<int64>(this->pipeline_frames_decoded_ * frame_shift * wave_rate);
+    int64 num_dropped = std::min<int64>(num_samples_decoded - this->segment_wave_offset_,
+                                        this->segment_wave_.size());
+    if (num_dropped > 0) {
+      this->segment_wave_.erase(this->segment_wave_.begin(), this->segment_wave_.begin() + num_dropped);
+      this->segment_wave_offset_ += num_dropped;
+    }
+    bool queued = (audio_state != AudioState::SpkrContinue || this->QueueFeatureFrames(false));
+    this->pipeline_busy_ns_ += SteadyTimeNs() - start_ns;
+    if (!queued) {
+      // cancelled at an endpoint
+      this->feature_audio_state_ = audio_state;
+      return;
     }
   }
-  // generate final results
-  if (num_seconds_decoded > 0.1) {
-    KALDI_VLOG(2) << "Getting lattice..";
-    decoder.FinalizeDecoding();
-    CompactLattice clat;
-    bool end_of_utterance = true;
-    decoder.GetLattice(end_of_utterance, &clat);
-    KALDI_VLOG(2) << "Lattice done";
 
-    int32 num_words = 0;
-    this->GenerateFinalResult(clat, &num_words, spkr);
-    if (num_words >= this->opts_->min_words_for_ivector_) {
-      // Only update adaptation state if the utterance contained enough words
-      feature_pipeline.GetAdaptationState(this->adaptation_state_);
+  int64 start_ns = SteadyTimeNs();
+  feature_pipeline.InputFinished();
+  this->QueueFeatureFrames(true);
+  this->pipeline_busy_ns_ += SteadyTimeNs() - start_ns;
+  this->feature_audio_state_ = audio_state;
+}
+
+bool OnlineDecoder::QueueFeatureFrames(bool input_finished) {
+  OnlineStreamFeaturePipeline &feature_pipeline = *(this->feature_pipeline_);
+  if (this->silence_weighting_->Active() && feature_pipeline.IvectorFeature() != NULL) {
+    {
+      std::lock_guard<std::mutex> silence_weighting_locker(this->silence_weighting_mtx_);
+      this->silence_weighting_->GetDeltaWeights(feature_pipeline.IvectorFeature()->NumFramesReady(),
+                                                &(this->delta_weights_));
+    }
+    feature_pipeline.IvectorFeature()->UpdateFrameWeights(this->delta_weights_);
+  }
+  ScopedStageTimer timer(&(this->stage_timers_), kStageNnet);
+  return this->decoder_->ComputeReadyFrames(input_finished);
+}
+
+// OnlineSilenceWeighting has no reset, nor an assignment since it holds
+// references; a copy of the initial one is constructed in place of the
+// previous segment's, which skips parsing the silence phones and the
+// allocation of the object
+void OnlineDecoder::ResetSilenceWeighting() {
+  this->silence_weighting_->~OnlineSilenceWeighting();
+  this->silence_weighting_ = new (this->silence_weighting_)
+      OnlineSilenceWeighting(*(this->initial_silence_weighting_));
+}
+
+// generate the final result of the segment and free its feature pipeline;
+// the decoder is kept for the next segment
+void OnlineDecoder::EndSegment() {
+  OnlineNnet3StreamDecoder &decoder = *(this->decoder_);
+  int64 decoding_start_ns = SteadyTimeNs();
+  this->frames_decoded_before_segment_ += decoder.NumFramesDecoded();
+  // generate final results
+  if (this->num_seconds_decoded_ > 0.1) {
+    if (this->opts_->async_finalization_) {
+      // the next segment starts from the adaptation state, so the best path
+      // decides it now instead of the final result
+      if (this->feature_pipeline_->IvectorFeature() != NULL) {
+        int32 num_unchanged = 0;
+        int32 num_words = decoder.TraceBackPartial(&num_unchanged).size();
+        if (num_words >= this->opts_->min_words_for_ivector_)
+          this->feature_pipeline_->GetAdaptationState(this->adaptation_state_);
+      }
+      // hand the decoder over and decode the next segment on the other one
+      this->WaitForFinalization();
+      std::swap(this->decoder_, this->finalizing_decoder_);
+      this->finalize_spkr_ = this->segment_spkr_;
+      this->finalize_segment_start_time_ = this->segment_start_time_;
+      this->finalize_total_time_decoded_ = this->total_time_decoded_;
+      this->finalizing_ = true;
+      if (this->finalize_thread_ == NULL)
+        this->finalize_thread_ = new std::thread(&OnlineDecoder::FinalizationLoop, this);
+      {
+        std::lock_guard<std::mutex> finalize_locker(this->finalize_mtx_);
+        this->finalize_pending_ = true;
+      }
+      this->finalize_cond_.notify_all();
+    } else {
+      int32 num_words = 0;
+      this->FinalizeSegment(this->decoder_, this->segment_spkr_, this->segment_start_time_,
+                            this->total_time_decoded_, &num_words);
+      if (num_words >= this->opts_->min_words_for_ivector_) {
+        // Only update adaptation state if the utterance contained enough words
+        this->feature_pipeline_->GetAdaptationState(this->adaptation_state_);
+      }
     }
   } else {
     KALDI_VLOG(2) << "Less than 0.1 seconds decoded, discarding ...";
   }
+  this->UpdateStats((SteadyTimeNs() - decoding_start_ns) * 1.0e-9, 0.0);
+
+  delete this->feature_pipeline_;
+  this->feature_pipeline_ = NULL;
+  this->segment_active_ = false;
+  this->segment_start_time_ = this->total_time_decoded_;
+}
+
+void OnlineDecoder::FinalizeSegment(OnlineNnet3StreamDecoder *decoder, const std::string &spkr,
+                                    float segment_start_time, float total_time_decoded,
+                                    int32 *num_words) {
+  KALDI_VLOG(2) << "Getting lattice..";
+  {
+    ScopedStageTimer timer(&(this->stage_timers_), kStageFinalizeDecoding);
+    decoder->FinalizeDecoding();
+  }
+  CompactLattice clat;
+  bool end_of_utterance = true;
+  {
+    ScopedStageTimer timer(&(this->stage_timers_), kStageGetLattice);
+    decoder->GetLattice(end_of_utterance, &clat);
+  }
+  KALDI_VLOG(2) << "Lattice done";
+
+  if (this->model_->lm_fst_ && this->model_->big_lm_) {
+    KALDI_VLOG(2) << "Rescoring lattice with the big LM";
+    ScopedStageTimer timer(&(this->stage_timers_), kStageRescoreLattice);
+    CompactLattice rescored_clat;
+    if (this->RescoreLattice(clat, &rescored_clat))
+      clat.Swap(&rescored_clat);
+  }
+
+  this->GenerateFinalResult(clat, num_words, spkr, segment_start_time, total_time_decoded);
+}
+
+void OnlineDecoder::FinalizeSegmentAsync() {
+  int64 finalize_start_ns = SteadyTimeNs();
+  try {
+    int32 num_words = 0;
+    this->FinalizeSegment(this->finalizing_decoder_, this->finalize_spkr_,
+                          this->finalize_segment_start_time_,
+                          this->finalize_total_time_decoded_, &num_words);
+  } catch (const std::exception &e) {
+    // KALDI_ERR must not escape the thread
+    KALDI_WARN << "Failed to finalize the segment: " << e.what();
+  }
+  this->finalize_ns_ = SteadyTimeNs() - finalize_start_ns;
+  this->finalizing_ = false;
+}
+
+void OnlineDecoder::FinalizationLoop() {
+  std::unique_lock<std::mutex> finalize_locker(this->finalize_mtx_);
+  while (true) {
+    this->finalize_cond_.wait(finalize_locker, [this] {
+      return this->finalize_pending_ || this->finalize_stop_; });
+    // a segment handed over before the stop is still finalized
+    if (!this->finalize_pending_)
+      break;
+    finalize_locker.unlock();
+    this->FinalizeSegmentAsync();
+    finalize_locker.lock();
+    this->finalize_pending_ = false;
+    this->finalize_done_ = true;
+    this->finalize_cond_.notify_all();
+  }
+}
+
+void OnlineDecoder::WaitForFinalization() {
+  if (this->finalize_thread_ == NULL)
+    return;
+  {
+    std::unique_lock<std::mutex> finalize_locker(this->finalize_mtx_);
+    this->finalize_cond_.wait(finalize_locker, [this] { return !this->finalize_pending_; });
+    if (!this->finalize_done_)
+      return;
+    this->finalize_done_ = false;
+  }
+  this->UpdateStats(this->finalize_ns_ * 1.0e-9, 0.0);
 }
 
 void OnlineDecoder::ChangeState(DecoderState newState)
@@ -819,11 +1278,25 @@ void OnlineDecoder::ChangeState(DecoderState newState)
 	state_cond_.notify_one();
 }
 
+void OnlineDecoder::ReceiveData(AudioBuffer* pBuffer)
+{
+	this->audio_source_->ReceiveData(pBuffer);
+	if (this->opts_->use_worker_pool_ && this->HasPendingWork())
+		this->ScheduleDecoding();
+}
+
 void OnlineDecoder::StartDecoding()
 {
+	this->segment_start_time_ = 0.0;
+	this->total_time_decoded_ = 0.0;
 	this->audio_source_->SetEnded(false);
 	this->ChangeState(DecoderState::State_OnDecoding);
-	decode_thread_ = new std::thread(&OnlineDecoder::DecodeLoop, this);
+	if (this->opts_->use_worker_pool_) {
+		if (this->HasPendingWork())
+			this->ScheduleDecoding();
+	} else {
+		decode_thread_ = new std::thread(&OnlineDecoder::DecodeLoop, this);
+	}
 }
 
 void OnlineDecoder::SuspendDecoding() {
@@ -831,6 +1304,9 @@ void OnlineDecoder::SuspendDecoding() {
 	KALDI_VLOG(2) << "Suspend Processing";
 	this->audio_source_->SetEnded(true);
 	this->ChangeState(DecoderState::State_SuspendDecoding);
+	// let a worker process the remaining data
+	if (this->opts_->use_worker_pool_ && this->HasPendingWork())
+		this->ScheduleDecoding();
 }
 
 void OnlineDecoder::ResumeDecoding() {
@@ -844,29 +1320,148 @@ void OnlineDecoder::StopDecoding() {
 	// set the audio source to ended to stop receive more data
 	this->audio_source_->SetEnded(true);
 	this->ChangeState(DecoderState::State_StopDecoding);
+	// let a worker process the remaining data and push EOS
+	if (this->opts_->use_worker_pool_ && this->HasPendingWork())
+		this->ScheduleDecoding();
 }
 
 void OnlineDecoder::WaitForEndOfDecoding()
 {
+	if (this->opts_->use_worker_pool_)
+	{
+		std::unique_lock<std::mutex> state_locker(state_mtx_);
+		state_cond_.wait(state_locker, [this] {return this->state_ == DecoderState::State_InitDecoding ||
+		                                              this->state_ == DecoderState::State_EndDecoding; });
+		state_locker.unlock();
+		// the task that pushed EOS may still be returning
+		this->WaitForTasks();
+	}
 	if (decode_thread_ != NULL)
 	{
 		decode_thread_->join();
 		delete decode_thread_;
 		decode_thread_ = NULL;
 	}
+	// EOS has been dispatched, wait until it has been delivered
+	if (this->result_dispatcher_ != NULL)
+		this->result_dispatcher_->Flush(id_);
+	if (this->stage_timers_.Enabled() && GetVerboseLevel() >= 1) {
+		std::ostringstream os;
+		this->stage_timers_.Write(os);
+		KALDI_VLOG(1) << "Stage timing of recognizer " << id_ << ":\n" << os.str();
+	}
+}
+
+// the recent real time factor is averaged with weights that decay over
+// about a second of audio; finalization only counts in the average
+void OnlineDecoder::UpdateStats(double decoding_secs, double audio_secs) {
+	double audio_decoded = this->stats_audio_decoded_;
+	if (audio_secs > 0) {
+		double rtf = decoding_secs / audio_secs;
+		double weight = std::min(1.0, audio_secs);
+		double recent_rtf = this->stats_recent_rtf_;
+		this->stats_recent_rtf_ = audio_decoded == 0 ? rtf : recent_rtf + weight * (rtf - recent_rtf);
+	}
+	this->stats_decoding_secs_ = this->stats_decoding_secs_ + decoding_secs;
+	this->stats_audio_decoded_ = audio_decoded + audio_secs;
+}
+
+void OnlineDecoder::GetStats(RecogStats *stats) const {
+	int64 now_ns = SteadyTimeNs();
+	double audio_decoded = this->stats_audio_decoded_;
+	stats->audio_received = static_cast<double>(this->audio_source_->NumSamplesReceived()) / this->sample_rate_;
+	stats->audio_decoded = audio_decoded;
+	stats->queued_samples = this->audio_source_->NumSamplesReady();
+	stats->real_time_factor = this->stats_recent_rtf_;
+	stats->average_real_time_factor = audio_decoded > 0 ? this->stats_decoding_secs_ / audio_decoded : 0.0;
+	stats->frames_decoded = this->stats_frames_decoded_;
+	stats->active_tokens = this->stats_active_tokens_;
+	int64 last_partial_ns = this->last_partial_time_ns_;
+	int64 last_final_ns = this->last_final_time_ns_;
+	stats->since_last_partial = last_partial_ns == 0 ? -1.0 : (now_ns - last_partial_ns) * 1.0e-9;
+	stats->since_last_final = last_final_ns == 0 ? -1.0 : (now_ns - last_final_ns) * 1.0e-9;
+}
+
+void OnlineDecoder::ScheduleDecoding()
+{
+	bool expected = false;
+	if (this->task_scheduled_.compare_exchange_strong(expected, true)) {
+		{
+			std::lock_guard<std::mutex> task_locker(task_mtx_);
+			this->num_tasks_++;
+		}
+		DecoderWorkerPool::Instance(this->opts_->num_workers_).Submit(
+			std::bind(&OnlineDecoder::DecodeAvailable, this));
+	}
+}
+
+bool OnlineDecoder::HasPendingWork()
+{
+	DecoderState state;
+	{
+		std::lock_guard<std::mutex> state_locker(state_mtx_);
+		state = state_;
+	}
+	if (state == DecoderState::State_InitDecoding || state == DecoderState::State_EndDecoding)
+		return false;
+	if (this->audio_state_ == AudioState::AudioEnd && this->audio_source_->Ended()) {
+		// all audio is decoded, the only thing left is finishing a stop
+		return state == DecoderState::State_StopDecoding;
+	}
+	int32 chunk_length = int32(this->sample_rate_ * this->opts_->chunk_length_in_secs_);
+	return this->audio_source_->DataReady(chunk_length);
+}
+
+// worker pool counterpart of DecodeLoop: runs as a pool task and returns as
+// soon as a whole chunk is not available instead of waiting for audio
+void OnlineDecoder::DecodeAvailable()
+{
+	BaseFloat traceback_period_secs = this->opts_->traceback_period_in_secs_;
+	int32 chunk_length = int32(this->sample_rate_ * this->opts_->chunk_length_in_secs_);
+	// give the worker back after this many chunks, so that other streams get
+	// their turn while a stream is catching up
+	const int32 max_chunks_per_task = 8;
+
+	for (int32 i = 0; i < max_chunks_per_task && this->HasPendingWork(); i++) {
+		AudioState audio_state = this->audio_state_;
+		if (audio_state == AudioState::AudioEnd && this->audio_source_->Ended()) {
+			this->WaitForFinalization();
+			KALDI_VLOG(2) << "Pushing EOS event";
+			this->InvokeCallBack(EOS_SIGNAL, NULL);
+			this->ChangeState(DecoderState::State_EndDecoding);
+			break;
+		}
+		if (!this->segment_active_)
+			this->BeginSegment();
+		bool segment_ended = this->DecodeChunk(audio_state, chunk_length, traceback_period_secs);
+		this->audio_state_ = audio_state;
+		if (segment_ended)
+			this->EndSegment();
+	}
+
+	this->task_scheduled_ = false;
+	// audio or a state change may have come in after the last check
+	if (this->HasPendingWork())
+		this->ScheduleDecoding();
+
+	// the recognizer may be freed as soon as this task is counted out
+	std::lock_guard<std::mutex> task_locker(task_mtx_);
+	this->num_tasks_--;
+	task_cond_.notify_all();
+}
+
+void OnlineDecoder::WaitForTasks()
+{
+	std::unique_lock<std::mutex> task_locker(task_mtx_);
+	task_cond_.wait(task_locker, [this] {return this->num_tasks_ == 0; });
 }
 
 // reference: gst_kaldinnet2onlinedecoder_loop
 void OnlineDecoder::DecodeLoop() {
-  start_ss = clock();
 	KALDI_VLOG(2) << "Starting decoding loop..";
 	BaseFloat traceback_period_secs = this->opts_->traceback_period_in_secs_;
 	int32 chunk_length = int32(this->sample_rate_ * this->opts_->chunk_length_in_secs_);
 
-	Vector<BaseFloat> remaining_wave_part;
-	this->segment_start_time_ = 0.0;
-	this->total_time_decoded_ = 0.0;
-	
 	AudioState audio_state = AudioState::SpkrContinue;
 	while (true) {
 		// check state for stop and suspend
@@ -885,7 +1480,6 @@ void OnlineDecoder::DecodeLoop() {
 				while (audio_state != AudioState::AudioEnd)
 				{
 					this->DecodeSegment(audio_state, chunk_length, traceback_period_secs);
-					this->segment_start_time_ = this->total_time_decoded_;
 				}
 				state_locker.lock();
 				
@@ -900,16 +1494,15 @@ void OnlineDecoder::DecodeLoop() {
 		}
 		
 	  this->DecodeSegment(audio_state, chunk_length, traceback_period_secs);
-	  this->segment_start_time_ = this->total_time_decoded_;
 	}
 
 	// Process remaining data in the audio buffer
 	while (audio_state != AudioState::AudioEnd)
 	{
 		this->DecodeSegment(audio_state, chunk_length, traceback_period_secs);
-		this->segment_start_time_ = this->total_time_decoded_;
 	}
 
+	this->WaitForFinalization();
 	KALDI_VLOG(2) << "Finished decoding loop";
 	KALDI_VLOG(2) << "Pushing EOS event";
 	this->InvokeCallBack(EOS_SIGNAL, NULL);
@@ -918,6 +1511,27 @@ void OnlineDecoder::DecodeLoop() {
 // Reference: gst_kaldinnet2onlinedecoder_finalize
 OnlineDecoder::~OnlineDecoder() {
 	KALDI_ASSERT(state_ == DecoderState::State_InitDecoding || DecoderState::State_EndDecoding);
+	// a pool task may still hold this recognizer
+	this->WaitForTasks();
+	// the last final result is dispatched by the finalization thread
+	this->WaitForFinalization();
+	if (this->finalize_thread_ != NULL) {
+		{
+			std::lock_guard<std::mutex> finalize_locker(this->finalize_mtx_);
+			this->finalize_stop_ = true;
+		}
+		this->finalize_cond_.notify_all();
+		this->finalize_thread_->join();
+		delete this->finalize_thread_;
+	}
+	if (this->result_dispatcher_ != NULL)
+		this->result_dispatcher_->Flush(id_);
+	if (this->segment_active_)
+		delete this->feature_pipeline_;
+	delete this->silence_weighting_;
+	delete this->initial_silence_weighting_;
+	delete this->decoder_;
+	delete this->finalizing_decoder_;
 	delete this->endpoint_config_;
 	delete this->feature_config_;
 	delete this->nnet3_decodable_opts_;
@@ -927,24 +1541,7 @@ OnlineDecoder::~OnlineDecoder() {
 	if (this->feature_info_) {
 		delete this->feature_info_;
 	}
-	if (this->trans_model_) {
-		delete this->trans_model_;
-	}
-	if (this->am_nnet3_) {
-		delete this->am_nnet3_;
-	}
-	if (this->decode_fst_) {
-		delete this->decode_fst_;
-	}
-	if (this->lm_fst_) {
-		delete this->lm_fst_;
-	}
-	if (this->lm_compose_cache_) {
-		delete this->lm_compose_cache_;
-	}
-	if (this->word_syms_) {
-		delete this->word_syms_;
-	}
+	delete this->resampler_;
 	if (this->adaptation_state_) {
 		delete this->adaptation_state_;
 	}
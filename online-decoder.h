@@ -18,8 +18,21 @@
 #include "lat/word-align-lattice.h"
 #include "hmm/hmm-utils.h"
 #include "lat/sausages.h"
+#include "feat/resample.h"
 #include "onlinedecoder/audio-buffer-source.h"
-
+#include "onlinedecoder/decoder-model.h"
+#include "onlinedecoder/decoder-worker-pool.h"
+#include "onlinedecoder/result-dispatcher.h"
+#include "onlinedecoder/json-writer.h"
+#include "onlinedecoder/recog-result.h"
+#include "onlinedecoder/stage-timing.h"
+#include "onlinedecoder/online-feature-pipeline.h"
+#include "onlinedecoder/online-nnet3-stream-decoding.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
 #include <mutex>
 #include <condition_variable>
 
@@ -30,11 +43,17 @@
 #define DEFAULT_WORD_BOUNDARY_FILE ""
 #define DEFAULT_LMWT_SCALE	1.0
 #define DEFAULT_CHUNK_LENGTH_IN_SECS  0.05
+#define DEFAULT_MAX_CHUNK_LENGTH_IN_SECS  DEFAULT_CHUNK_LENGTH_IN_SECS
 #define DEFAULT_TRACEBACK_PERIOD_IN_SECS  0.5
 #define DEFAULT_USE_THREADED_DECODER false
 #define DEFAULT_NUM_NBEST 1
 #define DEFAULT_NUM_PHONE_ALIGNMENT 1
 #define DEFAULT_MIN_WORDS_FOR_IVECTOR 2
+#define DEFAULT_BATCH_SIZE 32
+#define DEFAULT_BATCH_MAX_WAIT_MS 10
+#define DEFAULT_NUM_NBEST_THREADS 4
+#define DEFAULT_CALLBACK_QUEUE_SIZE 1024
+#define DEFAULT_MAX_QUEUED_FRAMES 100
 
 namespace kaldi {
 
@@ -77,6 +96,9 @@ struct _FullFinalResult {
   std::string spkr;
   std::vector<NBestResult> nbest_results;
   std::string phone_alignment;
+  // seconds of audio before the segment and up to its end
+  float segment_start_time;
+  float total_time_decoded;
 };
 
 /// OnlineDecoderOptions contains basic options for online decoder.
@@ -87,10 +109,19 @@ struct OnlineDecoderOptions {
 	bool inverse_scale_;
 	bool do_phone_alignment_;
 	bool do_partial_;
-	// bool use_threaded_decoder_;
+	bool map_fst_;
+	bool cache_looped_computation_;
+	bool batch_nnet_;
+	bool use_worker_pool_;
+	bool async_callbacks_;
+	bool stage_timing_;
+	bool async_finalization_;
+	bool use_threaded_decoder_;
+	bool block_features_;
 	
 	BaseFloat lmwt_scale_;
 	BaseFloat chunk_length_in_secs_;
+	BaseFloat max_chunk_length_in_secs_;
 	BaseFloat traceback_period_in_secs_;
 	BaseFloat punc_time1_;
 	BaseFloat punc_time2_;
@@ -99,14 +130,25 @@ struct OnlineDecoderOptions {
   int32 num_phone_alignment_;
 	int32 min_words_for_ivector_;
 	int32 real_sample_rate_;
+	int32 batch_size_;
+	int32 batch_max_wait_ms_;
+	int32 batch_extra_left_context_;
+	int32 num_workers_;
+	int32 num_nbest_threads_;
+	int32 num_callback_threads_;
+	int32 callback_queue_size_;
+	int32 max_queued_frames_;
   
 	std::string model_rspecifier_;
 	std::string fst_rspecifier_;
 	std::string lm_fst_rspecifier_;
+	std::string big_lm_const_arpa_rspecifier_;
 	std::string word_syms_filename_;
 	std::string phone_syms_filename_;
 	std::string word_boundary_info_filename_;
 	std::string adaptation_state_str_;
+	std::string callback_overflow_;
+	std::string decoder_type_;
 
 
   
@@ -115,27 +157,55 @@ struct OnlineDecoderOptions {
                  inverse_scale_(false),
                  do_phone_alignment_(false),
                  do_partial_(true),
+                 map_fst_(false),
+                 cache_looped_computation_(false),
+                 batch_nnet_(false),
+                 use_worker_pool_(false),
+                 async_callbacks_(false),
+                 stage_timing_(false),
+                 async_finalization_(false),
+                 use_threaded_decoder_(DEFAULT_USE_THREADED_DECODER),
+                 block_features_(false),
                  lmwt_scale_(DEFAULT_LMWT_SCALE),
                  chunk_length_in_secs_(DEFAULT_CHUNK_LENGTH_IN_SECS),
+                 max_chunk_length_in_secs_(DEFAULT_MAX_CHUNK_LENGTH_IN_SECS),
                  traceback_period_in_secs_(DEFAULT_TRACEBACK_PERIOD_IN_SECS),
                  punc_time1_(0.5),
                  punc_time2_(0.1),
                  num_nbest_(DEFAULT_NUM_NBEST),
                  num_phone_alignment_(DEFAULT_NUM_PHONE_ALIGNMENT),
                  min_words_for_ivector_(DEFAULT_MIN_WORDS_FOR_IVECTOR),
+                 batch_size_(DEFAULT_BATCH_SIZE),
+                 batch_max_wait_ms_(DEFAULT_BATCH_MAX_WAIT_MS),
+                 batch_extra_left_context_(0),
+                 num_workers_(0),
+                 num_nbest_threads_(DEFAULT_NUM_NBEST_THREADS),
+                 num_callback_threads_(1),
+                 callback_queue_size_(DEFAULT_CALLBACK_QUEUE_SIZE),
+                 max_queued_frames_(DEFAULT_MAX_QUEUED_FRAMES),
                  model_rspecifier_(DEFAULT_MODEL),
                  fst_rspecifier_(DEFAULT_FST),
                  word_syms_filename_(DEFAULT_WORD_SYMS),
                  phone_syms_filename_(DEFAULT_PHONE_SYMS),
                  word_boundary_info_filename_(DEFAULT_WORD_BOUNDARY_FILE),
-                 adaptation_state_str_("") {}
+                 adaptation_state_str_(""),
+                 callback_overflow_("block"),
+                 decoder_type_("lattice") {}
   
   void Register(OptionsItf *opts) {
     
     opts->Register("model", &model_rspecifier_, "Filename of the acoustic model.");  
               
     opts->Register("fst", &fst_rspecifier_, "Filename of the HCLG FST");
+
+    opts->Register("map-fst", &map_fst_, "If true, memory-map the HCLG FST instead of "
+        "reading it into memory. The FST must be converted with "
+        "fstconvert --fst_type=const --fst_align, default false.");
     
+    opts->Register("cache-looped-computation", &cache_looped_computation_, "If true, "
+        "keep the compiled nnet3 looped computation in a file next to the model "
+        "and read it from there when creating later recognizers, default false.");
+
     opts->Register("word-syms", &word_syms_filename_, "Name of word symbols "
         "file (typically words.txt)");
         
@@ -160,13 +230,28 @@ struct OnlineDecoderOptions {
     opts->Register("chunk-length-in-secs", &chunk_length_in_secs_, 
         "Length of a audio chunk that is processed at a time."
         "Smaller values decrease latency, bigger values (e.g. 0.2) "
-        "improve speed if multithreaded BLAS/MKL is used");
+        "improve speed if multithreaded BLAS/MKL is used. "
+        "This is the chunk of a live stream, and the smallest chunk read");
+
+    opts->Register("max-chunk-length-in-secs", &max_chunk_length_in_secs_,
+        "Longest audio chunk processed at a time. A recognizer that is behind reads "
+        "as much of its backlog as it can, in whole multiples of chunk-length-in-secs "
+        "up to this length, so that it catches up with fewer and bigger chunks. "
+        "Endpoints are only checked after a whole chunk, so a longer chunk may end a "
+        "segment later; no bigger than chunk-length-in-secs for a fixed chunk length, "
+        "default chunk-length-in-secs.");
         
     opts->Register("traceback-period-in-secs", &traceback_period_in_secs_, 
         "Time period after which new interim recognition result is sent");
         
     opts->Register("lm-fst", &lm_fst_rspecifier_, "Language language model FST (G.fst), "
-        "only needed when rescoring with the constant ARPA LM");
+        "only needed when rescoring with the constant ARPA LM. Its arc lookup tables "
+        "are built once per model and shared by all recognizers, which take turns "
+        "composing their final lattices with it");
+
+    opts->Register("big-lm-const-arpa", &big_lm_const_arpa_rspecifier_, "Big language "
+        "model in ConstArpaLm format (as written by arpa-to-const-arpa); final lattices "
+        "are rescored with it, replacing the scores of lm-fst");
         
     opts->Register("word-boundary-file", &word_boundary_info_filename_, 
         "Word-boundary file. Setting this property triggers generating word "
@@ -176,6 +261,10 @@ struct OnlineDecoderOptions {
     
     opts->Register("num-phone-alignment", &num_phone_alignment_, "number of hypotheses "
         "where alignment should be done");
+
+    opts->Register("num-nbest-threads", &num_nbest_threads_, "Most threads aligning "
+        "the hypotheses of a full final result at once: the decoding thread and tasks "
+        "on the worker pool, which is started if use-worker-pool=false.");
     
     opts->Register("min-words-for-ivector", &min_words_for_ivector_,
         "threshold for updating ivector (adaptation state). "
@@ -190,6 +279,64 @@ struct OnlineDecoderOptions {
     
     opts->Register("do-partial-result", &do_partial_, "If false, never return partial result, "
         "even the callback function of partial signal is set, default true.");
+
+    opts->Register("batch-nnet", &batch_nnet_, "If true, evaluate the acoustic model in "
+        "minibatches shared by all recognizers using the same model, default false.");
+
+    opts->Register("batch-size", &batch_size_, "Number of chunks in a shared minibatch "
+        "when batch-nnet=true.");
+
+    opts->Register("batch-max-wait-ms", &batch_max_wait_ms_, "Longest time a chunk waits "
+        "for its minibatch to fill before a partial minibatch is computed.");
+
+    opts->Register("batch-extra-left-context", &batch_extra_left_context_, "Extra left "
+        "context per chunk when batch-nnet=true, for recurrent models.");
+
+    opts->Register("use-worker-pool", &use_worker_pool_, "If true, decode on a fixed pool "
+        "of workers shared by all recognizers instead of a thread per recognizer; a "
+        "recognizer only occupies a worker while it has audio ready, default false.");
+
+    opts->Register("num-workers", &num_workers_, "Number of workers in the pool, 0 for one "
+        "per hardware thread. Only the first recognizer using the pool sets it.");
+
+    opts->Register("decoder-type", &decoder_type_, "Search of the recognizer: lattice, or "
+        "one-best for a lattice-free search that is cheaper but only gives the best "
+        "hypothesis, with no n-best and no silence weighting of the iVectors.");
+
+    opts->Register("use-threaded-decoder", &use_threaded_decoder_, "If true, compute the "
+        "features and the acoustic model on a second thread per recognizer, pipelined "
+        "with the search. Can't be combined with batch-nnet or use-worker-pool.");
+
+    opts->Register("max-queued-frames", &max_queued_frames_, "Most acoustic model frames "
+        "the feature thread gets ahead of the search when use-threaded-decoder=true.");
+
+    opts->Register("block-features", &block_features_, "If true, compute mfcc or fbank "
+        "features a block of frames at a time, with the windows, FFTs and mel banks of "
+        "all the frames of an audio chunk done as matrix operations, default false.");
+
+    opts->Register("async-finalization", &async_finalization_, "If true, get the lattice "
+        "and the final result of a segment on a second thread while the next segment is "
+        "decoded. The adaptation state is then updated on the best path word count, and "
+        "partial results wait for the final result before them, default false.");
+
+    opts->Register("async-callbacks", &async_callbacks_, "If true, call the result "
+        "callbacks on delivery threads shared by all recognizers instead of on the "
+        "decoding thread, default false.");
+
+    opts->Register("num-callback-threads", &num_callback_threads_, "Number of result "
+        "delivery threads when async-callbacks=true. The results of a recognizer are "
+        "always delivered in order by the same thread.");
+
+    opts->Register("callback-queue-size", &callback_queue_size_, "Most results waiting "
+        "for delivery on one delivery thread.");
+
+    opts->Register("callback-overflow", &callback_overflow_, "What to do with a new "
+        "result when its delivery queue is full: block (wait for room) or drop-partial "
+        "(drop partial results superseded by a later one, or the new partial result).");
+
+    opts->Register("stage-timing", &stage_timing_, "If true, time the decoding stages "
+        "of each recognizer into histograms, logged at verbose level 1 when decoding "
+        "ends. Can also be switched at runtime with SetStageTiming.");
   }
 };
 
@@ -210,21 +357,25 @@ public:
 	explicit OnlineDecoder(int id, const string& configFilePath);
 	~OnlineDecoder();
 	
-	// TODO: load settings from config file
-	void LoadWordSyms();
-	void LoadPhoneSyms();
-	void LoadWordBoundaryInfo();
-	void LoadAcousticModel();
-	void LoadFst();
-	void LoadLmFst();
+	// rescore a final lattice with the big LM
+	bool RescoreLattice(const CompactLattice &clat, CompactLattice *rescored_clat);
 	
 	bool LoadModel();
 	void Finalize();
 	
-	void ReceiveData(AudioBuffer* pBuffer ) {audio_source_->ReceiveData(pBuffer);};
+	void ReceiveData(AudioBuffer* pBuffer );
+
+	// pooled buffers for ReceiveData, called from the thread feeding audio
+	AudioBuffer* GetBuffer(int32 size) { return audio_source_->BufferPool().Get(size); }
+	AudioBuffer* AcquireBuffer(int32 size) { return audio_source_->BufferPool().Acquire(size); }
+	AudioBuffer* TakeAcquiredBuffer(const SampleType* pData) {
+		return audio_source_->BufferPool().TakeAcquired(pData);
+	}
+	void DiscardBuffer(AudioBuffer* pBuffer) { audio_source_->BufferPool().Discard(pBuffer); }
 
 	// Add callback functions
 	void AddCallBack(DecoderSignal signal, DecoderSignalCallback onSignal);
+	void AddFullResultCallBack(FullResultCallback onResult);
 	
 	void StartDecoding();
 
@@ -238,6 +389,13 @@ public:
 	
 	void ChangePartial() {opts_->do_partial_ = !opts_->do_partial_;};
 
+	// can be called while decoding; switching on keeps what was timed before
+	void SetStageTiming(bool enable) { stage_timers_.SetEnabled(enable); }
+	const StageTimers &GetStageTimers() const { return stage_timers_; }
+
+	// safe to call from any thread
+	void GetStats(RecogStats *stats) const;
+
 protected:
 
 	void ChangeState(DecoderState newState);
@@ -249,22 +407,89 @@ protected:
 	void DecodeLoop();
 	
 	// Generate final results and emit signal FINAL_RESULT_SIGNAL and FULL_FINAL_RESULT_SIGNAL
-	void GenerateFinalResult(CompactLattice &clat, int32 *num_words, string spkr);
+	void GenerateFinalResult(CompactLattice &clat, int32 *num_words, string spkr,
+	                         float segment_start_time, float total_time_decoded);
 	
-	// Generate partial results and emit signal PARTIAL_RESULT_SIGNAL
-	void GeneratePartialResult(const Lattice lat);
+	// Generate partial results and emit signal PARTIAL_RESULT_SIGNAL; the first
+	// num_unchanged words are the same as in the previous partial result
+	void GeneratePartialResult(const std::vector<int32> &words, int32 num_unchanged);
 	
 	// Decode for a segment/utterance
 	void DecodeSegment(AudioState &audio_state, int32 chunk_length, BaseFloat traceback_period_secs);
+
+	// Decode a segment step by step: BeginSegment, DecodeChunk until it
+	// returns true, then EndSegment
+	void BeginSegment();
+	void ResetSilenceWeighting();
+	bool DecodeChunk(AudioState &audio_state, int32 chunk_length, BaseFloat traceback_period_secs);
+	void EndSegment();
+
+	// samples of the next chunk to read: chunk_length while the stream is
+	// live, up to max-chunk-length-in-secs as the audio waiting to be read
+	// grows
+	int32 NextChunkLength(int32 chunk_length) const;
+
+	// get the final lattice of a segment from decoder, rescore it and
+	// generate the final result
+	void FinalizeSegment(OnlineNnet3StreamDecoder *decoder, const std::string &spkr,
+	                     float segment_start_time, float total_time_decoded, int32 *num_words);
+	// async finalization: finalizes the segment in finalize_spkr_ etc.
+	void FinalizeSegmentAsync();
+	// async finalization: the finalization thread, started with the first
+	// segment and kept until the recognizer is destroyed
+	void FinalizationLoop();
+	// async finalization: wait until the previous segment is finalized and
+	// account for the time it took
+	void WaitForFinalization();
+
+	// resample the audio if needed and give it to the features; returns the
+	// audio as the features got it, at WaveSampleRate()
+	const VectorBase<BaseFloat> &AcceptWave(const VectorBase<BaseFloat> &wave, bool flush);
+	BaseFloat WaveSampleRate() const {
+		return this->resampler_ != NULL ? this->resampler_->GetOutputSamplingRate() : this->sample_rate_;
+	}
+
+	// generate a partial result if traceback_period_secs have been decoded
+	// since the last one
+	void MaybeGeneratePartialResult(BaseFloat traceback_period_secs);
+
+	// threaded decoder: decode a segment whose features and acoustic scores
+	// are computed by FeedSegment on the feature thread
+	void DecodeSegmentPipelined(AudioState &audio_state, int32 chunk_length, BaseFloat traceback_period_secs);
+	void FeedSegment(int32 chunk_length);
+	// compute and queue the acoustic scores of the features ready, false if
+	// the search has cancelled the segment
+	bool QueueFeatureFrames(bool input_finished);
+
+	// worker pool mode: queue a DecodeAvailable task unless one is queued or running
+	void ScheduleDecoding();
+
+	// worker pool mode: decode the chunks that are ready without waiting for audio
+	void DecodeAvailable();
+
+	// worker pool mode: true if DecodeAvailable has something to do
+	bool HasPendingWork();
+
+	// worker pool mode: wait until no DecodeAvailable task is queued or running
+	void WaitForTasks();
 	
 protected:
-	std::vector<PhoneAlignmentInfo> GetPhoneAlignment(const std::vector<int32>& alignment, const CompactLattice &clat);
+	// phone_clat is the final lattice with its words replaced by phones, see
+	// ConvertLatticeToPhones
+	std::vector<PhoneAlignmentInfo> GetPhoneAlignment(const std::vector<int32>& alignment, const CompactLattice &phone_clat);
 	std::vector<WordAlignmentInfo> GetWordAlignment(const Lattice &lat, const std::vector<BaseFloat> &confidences);
 	void ScaleLattice(CompactLattice &clat);
 	std::string Words2String(const std::vector<int32> &words);
 	std::string WordsInHyp2String(const std::vector<WordInHypothesis> &words);
 	std::vector<NBestResult> GetNbestResults(CompactLattice &clat);
-	std::string FullFinalResult2Json(const FullFinalResult &full_final_result);
+	// aligns some of the hypotheses of GetNbestResults, one per thread
+	class NbestAlignment;
+	// the JSON is written into json_writer_ and valid until the next call
+	const std::string &FullFinalResult2Json(const FullFinalResult &full_final_result);
+	void FullFinalResult2Struct(const FullFinalResult &full_final_result,
+	                            RecogResultStorage *storage);
+	// emit the full final result to the FullResultCallback functions
+	void InvokeFullResultCallBack(const FullFinalResult &full_final_result);
 	
 	std::string WordsInHyp2String(const std::vector<PhoneAlignmentInfo> &phone_alignment, 
 	                              const std::vector<WordAlignmentInfo> &word_alignment);
@@ -285,32 +510,121 @@ protected:
 	AudioBufferSource* audio_source_;
 	
 	OnlineNnet2FeaturePipelineInfo *feature_info_;
-	TransitionModel *trans_model_;
-	nnet3::AmNnetSimple *am_nnet3_;
-	nnet3::DecodableNnetSimpleLoopedInfo *decodable_info_nnet3_;
-	fst::Fst<fst::StdArc> *decode_fst_;
-	
-	fst::SymbolTable *word_syms_;
-	fst::SymbolTable *phone_syms_;
-	WordBoundaryInfo *word_boundary_info_;
+
+	// read-only models, shared with other recognizers using the same config
+	std::shared_ptr<const DecoderModel> model_;
 	int32 sample_rate_;
+	// set when sample_rate_ differs from the model's rate
+	LinearResample *resampler_;
+	Vector<BaseFloat> resampled_wave_;
 
 	std::mutex state_mtx_;
 	std::condition_variable state_cond_;
 	DecoderState state_;
 	std::thread* decode_thread_;
 
+	// worker pool mode: set while a DecodeAvailable task is queued or running
+	std::atomic<bool> task_scheduled_;
+	// worker pool mode: DecodeAvailable tasks that have not returned yet,
+	// which may still use the recognizer after clearing task_scheduled_
+	std::mutex task_mtx_;
+	std::condition_variable task_cond_;
+	int32 num_tasks_;
+	std::atomic<AudioState> audio_state_;
+
+	// state of the segment being decoded
+	bool segment_active_;
+	OnlineStreamFeaturePipeline *feature_pipeline_;
+	// created with the model and reset for every segment from
+	// initial_silence_weighting_, which has the silence phones parsed
+	OnlineSilenceWeighting *silence_weighting_;
+	OnlineSilenceWeighting *initial_silence_weighting_;
+	// created with the model and reused by every segment
+	OnlineNnet3StreamDecoder *decoder_;
+	// parsed from decoder-type
+	StreamSearchType search_type_;
+	// async finalization: the decoder of the segment being finalized, swapped
+	// with decoder_ when a segment ends
+	OnlineNnet3StreamDecoder *finalizing_decoder_;
+	std::thread *finalize_thread_;
+	// finalize_pending_ from the handover until the segment is finalized,
+	// finalize_done_ until WaitForFinalization has counted its time
+	std::mutex finalize_mtx_;
+	std::condition_variable finalize_cond_;
+	bool finalize_pending_;
+	bool finalize_done_;
+	bool finalize_stop_;
+	// set until the finalization thread has delivered the final result;
+	// partial results of the next segment wait for it, to stay in order
+	std::atomic<bool> finalizing_;
+	std::string finalize_spkr_;
+	float finalize_segment_start_time_;
+	float finalize_total_time_decoded_;
+	int64 finalize_ns_;
+	Vector<BaseFloat> wave_part_;
+	std::vector<std::pair<int32, BaseFloat> > delta_weights_;
+	BaseFloat last_traceback_;
+	BaseFloat num_seconds_decoded_;
+	std::string segment_spkr_;
+
+	// threaded decoder: the feature thread of the segment and the audio state
+	// it ended on
+	std::thread *feature_thread_;
+	AudioState feature_audio_state_;
+	// the search computes the traceback, the feature thread uses it
+	std::mutex silence_weighting_mtx_;
+	// published by the search, so the feature thread can drop decoded audio
+	std::atomic<int32> pipeline_frames_decoded_;
+	// time the feature thread has worked since the search last took it
+	std::atomic<int64> pipeline_busy_ns_;
+	// the audio given to the features of the segment, from sample
+	// segment_wave_offset_ on; the samples before it are decoded
+	std::vector<BaseFloat> segment_wave_;
+	int64 segment_wave_offset_;
+	// after an endpoint, the audio the search had not reached; it starts the
+	// next segment
+	Vector<BaseFloat> carried_wave_;
+	std::string carried_spkr_;
+	AudioState carried_audio_state_;
+	// the last partial result, and its length after each of its words
+	std::string partial_transcript_;
+	std::vector<size_t> partial_word_ends_;
+
 	OnlineIvectorExtractorAdaptationState *adaptation_state_;
 	
 	float segment_start_time_;
 	float total_time_decoded_;
   
-	// The following are needed for optional LM rescoring with a "big" LM
-	fst::MapFst<fst::StdArc, LatticeArc, fst::StdToLatticeMapper<BaseFloat> > *lm_fst_;
-	fst::TableComposeCache<fst::Fst<LatticeArc> > *lm_compose_cache_;
+
+	// reused for every full final result
+	JsonWriter json_writer_;
+	// storages of the full final results, reused once delivered
+	std::shared_ptr<RecogResultStoragePool> full_result_storages_;
 	
 	// callback functions
 	std::map< DecoderSignal, std::vector<DecoderSignalCallback> > onDecoderSignalCallbacks_;
+	std::vector<FullResultCallback> onFullResultCallbacks_;
+	// delivers the results when async-callbacks=true, NULL otherwise
+	ResultDispatcher *result_dispatcher_;
+
+	// durations of the decoding stages, when stage timing is on
+	StageTimers stage_timers_;
+
+	// progress published by the decoding thread for GetStats
+	std::atomic<double> stats_audio_decoded_;
+	std::atomic<double> stats_decoding_secs_;
+	std::atomic<double> stats_recent_rtf_;
+	std::atomic<int32> stats_frames_decoded_;
+	std::atomic<int32> stats_active_tokens_;
+	// steady_clock times of the last partial and final result in
+	// nanoseconds, 0 before the first one
+	std::atomic<int64> last_partial_time_ns_;
+	std::atomic<int64> last_final_time_ns_;
+	// frames of the segments before the current one
+	int32 frames_decoded_before_segment_;
+
+	// account for decoding_secs of work on audio_secs of audio
+	void UpdateStats(double decoding_secs, double audio_secs);
 	
 
 };
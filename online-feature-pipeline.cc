@@ -0,0 +1,105 @@
+// 张; 杨
+#include "onlinedecoder/online-feature-pipeline.h"
+#include "onlinedecoder/online-block-feature.h"
+
+namespace kaldi {
+
+OnlineStreamFeaturePipeline::OnlineStreamFeaturePipeline(
+	const OnlineNnet2FeaturePipelineInfo &info, bool block_features):
+	info_(info),
+	kaldi_pipeline_(NULL) {
+	if (!block_features || (info_.feature_type != "mfcc" && info_.feature_type != "fbank")) {
+		this->kaldi_pipeline_ = new OnlineNnet2FeaturePipeline(info_);
+		this->base_feature_ = NULL;
+		this->pitch_ = NULL;
+		this->pitch_feature_ = NULL;
+		this->feature_plus_optional_pitch_ = this->kaldi_pipeline_->InputFeature();
+		this->ivector_feature_ = this->kaldi_pipeline_->IvectorFeature();
+		this->final_feature_ = this->kaldi_pipeline_;
+		this->dim_ = this->kaldi_pipeline_->Dim();
+		return;
+	}
+
+	if (info_.feature_type == "mfcc")
+		this->base_feature_ = new OnlineBlockMfcc(info_.mfcc_opts);
+	else
+		this->base_feature_ = new OnlineBlockFbank(info_.fbank_opts);
+
+	if (info_.add_pitch) {
+		this->pitch_ = new OnlinePitchFeature(info_.pitch_opts);
+		this->pitch_feature_ = new OnlineProcessPitch(info_.pitch_process_opts, this->pitch_);
+		this->feature_plus_optional_pitch_ = new OnlineAppendFeature(this->base_feature_,
+		                                                             this->pitch_feature_);
+	} else {
+		this->pitch_ = NULL;
+		this->pitch_feature_ = NULL;
+		this->feature_plus_optional_pitch_ = this->base_feature_;
+	}
+
+	if (info_.use_ivectors) {
+		this->ivector_feature_ = new OnlineIvectorFeature(info_.ivector_extractor_info,
+		                                                  this->base_feature_);
+		this->final_feature_ = new OnlineAppendFeature(this->feature_plus_optional_pitch_,
+		                                               this->ivector_feature_);
+	} else {
+		this->ivector_feature_ = NULL;
+		this->final_feature_ = this->feature_plus_optional_pitch_;
+	}
+	this->dim_ = this->final_feature_->Dim();
+}
+
+OnlineStreamFeaturePipeline::~OnlineStreamFeaturePipeline() {
+	if (this->kaldi_pipeline_ != NULL) {
+		delete this->kaldi_pipeline_;
+		return;
+	}
+	// the Append objects don't own their inputs, so delete them in reverse
+	// order of construction
+	if (this->final_feature_ != this->feature_plus_optional_pitch_)
+		delete this->final_feature_;
+	delete this->ivector_feature_;
+	if (this->feature_plus_optional_pitch_ != this->base_feature_)
+		delete this->feature_plus_optional_pitch_;
+	delete this->pitch_feature_;
+	delete this->pitch_;
+	delete this->base_feature_;
+}
+
+void OnlineStreamFeaturePipeline::SetAdaptationState(
+	const OnlineIvectorExtractorAdaptationState &adaptation_state) {
+	if (this->kaldi_pipeline_ != NULL)
+		this->kaldi_pipeline_->SetAdaptationState(adaptation_state);
+	else if (this->ivector_feature_ != NULL)
+		this->ivector_feature_->SetAdaptationState(adaptation_state);
+}
+
+void OnlineStreamFeaturePipeline::GetAdaptationState(
+	OnlineIvectorExtractorAdaptationState *adaptation_state) const {
+	if (this->kaldi_pipeline_ != NULL)
+		this->kaldi_pipeline_->GetAdaptationState(adaptation_state);
+	else if (this->ivector_feature_ != NULL)
+		this->ivector_feature_->GetAdaptationState(adaptation_state);
+}
+
+void OnlineStreamFeaturePipeline::AcceptWaveform(BaseFloat sampling_rate,
+                                                 const VectorBase<BaseFloat> &waveform) {
+	if (this->kaldi_pipeline_ != NULL) {
+		this->kaldi_pipeline_->AcceptWaveform(sampling_rate, waveform);
+		return;
+	}
+	this->base_feature_->AcceptWaveform(sampling_rate, waveform);
+	if (this->pitch_ != NULL)
+		this->pitch_->AcceptWaveform(sampling_rate, waveform);
+}
+
+void OnlineStreamFeaturePipeline::InputFinished() {
+	if (this->kaldi_pipeline_ != NULL) {
+		this->kaldi_pipeline_->InputFinished();
+		return;
+	}
+	this->base_feature_->InputFinished();
+	if (this->pitch_ != NULL)
+		this->pitch_->InputFinished();
+}
+
+}
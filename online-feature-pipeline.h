@@ -0,0 +1,69 @@
+// 张; 杨
+#ifndef KALDI_ONLINE_FEATURE_PIPELINE_H_
+#define KALDI_ONLINE_FEATURE_PIPELINE_H_
+
+#include "online2/online-nnet2-feature-pipeline.h"
+
+namespace kaldi {
+
+/// OnlineNnet2FeaturePipeline that can compute its mfcc or fbank base
+/// features a block at a time, see OnlineBlockFeature. Everything else,
+/// pitch and iVectors included, is configured by the same
+/// OnlineNnet2FeaturePipelineInfo and behaves the same. Kaldi's pipeline
+/// has no way to take other base features, so only that case is built here.
+/// Reference: OnlineNnet2FeaturePipeline
+class OnlineStreamFeaturePipeline: public OnlineFeatureInterface {
+ public:
+	// with block_features false, or for plp, this is Kaldi's pipeline itself
+	OnlineStreamFeaturePipeline(const OnlineNnet2FeaturePipelineInfo &info,
+	                            bool block_features);
+	virtual ~OnlineStreamFeaturePipeline();
+
+	/// Member functions from OnlineFeatureInterface, for the final features
+	/// (input features with the iVectors appended, if any)
+	virtual int32 Dim() const { return dim_; }
+	virtual bool IsLastFrame(int32 frame) const { return final_feature_->IsLastFrame(frame); }
+	virtual int32 NumFramesReady() const { return final_feature_->NumFramesReady(); }
+	virtual void GetFrame(int32 frame, VectorBase<BaseFloat> *feat) {
+		final_feature_->GetFrame(frame, feat);
+	}
+	virtual BaseFloat FrameShiftInSeconds() const { return info_.FrameShiftInSeconds(); }
+
+	void SetAdaptationState(const OnlineIvectorExtractorAdaptationState &adaptation_state);
+	void GetAdaptationState(OnlineIvectorExtractorAdaptationState *adaptation_state) const;
+
+	void AcceptWaveform(BaseFloat sampling_rate, const VectorBase<BaseFloat> &waveform);
+
+	/// no more waveform will be given, so the last frames can be computed
+	void InputFinished();
+
+	/// the input features of the nnet, with pitch if configured
+	OnlineFeatureInterface *InputFeature() { return feature_plus_optional_pitch_; }
+
+	/// NULL if the nnet doesn't take iVectors
+	OnlineIvectorFeature *IvectorFeature() { return ivector_feature_; }
+	const OnlineIvectorFeature *IvectorFeature() const { return ivector_feature_; }
+
+ private:
+	const OnlineNnet2FeaturePipelineInfo &info_;
+
+	// Kaldi's pipeline without block features, else NULL and the features
+	// below are ours; the pointers below are set in both cases
+	OnlineNnet2FeaturePipeline *kaldi_pipeline_;
+
+	OnlineBaseFeature *base_feature_;
+	OnlinePitchFeature *pitch_;
+	OnlineProcessPitch *pitch_feature_;
+	// base_feature_ itself without pitch
+	OnlineFeatureInterface *feature_plus_optional_pitch_;
+	OnlineIvectorFeature *ivector_feature_;
+	// feature_plus_optional_pitch_ itself without iVectors
+	OnlineFeatureInterface *final_feature_;
+	int32 dim_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineStreamFeaturePipeline);
+};
+
+}
+
+#endif  // KALDI_ONLINE_FEATURE_PIPELINE_H_
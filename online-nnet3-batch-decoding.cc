@@ -0,0 +1,191 @@
+// 张; 杨
+#include "onlinedecoder/online-nnet3-batch-decoding.h"
+#include "nnet3/nnet-utils.h"
+
+#include <chrono>
+
+namespace kaldi {
+
+NnetBatchScheduler::NnetBatchScheduler(
+	const nnet3::NnetBatchComputerOptions &opts,
+	const nnet3::Nnet &nnet,
+	const VectorBase<BaseFloat> &priors,
+	int32 max_wait_ms):
+	opts_(opts),
+	computer_(opts_, nnet, priors),
+	max_wait_ms_(max_wait_ms),
+	num_pending_(0),
+	finished_(false) {
+	KALDI_ASSERT(opts_.frames_per_chunk % opts_.frame_subsampling_factor == 0);
+	nnet3::ComputeSimpleNnetContext(nnet, &left_context_, &right_context_);
+	left_context_ += opts_.extra_left_context;
+	right_context_ += opts_.extra_right_context;
+	compute_thread_ = new std::thread(&NnetBatchScheduler::ComputeLoop, this);
+}
+
+void NnetBatchScheduler::Compute(std::vector<nnet3::NnetInferenceTask> *tasks) {
+	for (size_t i = 0; i < tasks->size(); i++) {
+		computer_.AcceptTask(&((*tasks)[i]));
+	}
+	{
+		std::lock_guard<std::mutex> pending_locker(pending_mtx_);
+		num_pending_ += tasks->size();
+	}
+	pending_cond_.notify_one();
+	// the computer signals each task's semaphore once its output is ready
+	for (size_t i = 0; i < tasks->size(); i++) {
+		(*tasks)[i].semaphore.Wait();
+	}
+}
+
+void NnetBatchScheduler::ComputeLoop() {
+	std::unique_lock<std::mutex> pending_locker(pending_mtx_);
+	while (true) {
+		pending_cond_.wait(pending_locker, [this] { return this->num_pending_ > 0 || this->finished_; });
+		if (num_pending_ == 0 && finished_)
+			break;
+		// give the other streams a moment to fill the minibatch
+		pending_cond_.wait_for(pending_locker, std::chrono::milliseconds(max_wait_ms_),
+		                       [this] { return this->num_pending_ >= this->opts_.minibatch_size || this->finished_; });
+		num_pending_ = 0;
+		pending_locker.unlock();
+		// tasks arriving while we compute are picked up here or in the next round
+		while (computer_.Compute(true));
+		pending_locker.lock();
+	}
+}
+
+NnetBatchScheduler::~NnetBatchScheduler() {
+	{
+		std::lock_guard<std::mutex> pending_locker(pending_mtx_);
+		finished_ = true;
+	}
+	pending_cond_.notify_one();
+	compute_thread_->join();
+	delete compute_thread_;
+}
+
+DecodableNnetBatchOnline::DecodableNnetBatchOnline(
+	const TransitionModel &trans_model,
+	NnetBatchScheduler *scheduler,
+	OnlineFeatureInterface *input_features,
+	OnlineFeatureInterface *ivector_features):
+	trans_model_(trans_model),
+	scheduler_(scheduler),
+	input_features_(input_features),
+	ivector_features_(ivector_features),
+	current_log_post_offset_(0) { }
+
+void DecodableNnetBatchOnline::Reset(OnlineFeatureInterface *input_features,
+                                     OnlineFeatureInterface *ivector_features) {
+	input_features_ = input_features;
+	ivector_features_ = ivector_features;
+	current_log_post_.Resize(0, 0);
+	current_log_post_offset_ = 0;
+}
+
+// Reference: DecodableNnetLoopedOnlineBase::NumFramesReady
+int32 DecodableNnetBatchOnline::NumFramesReady() const {
+	int32 features_ready = input_features_->NumFramesReady();
+	if (features_ready == 0)
+		return 0;
+	bool input_finished = input_features_->IsLastFrame(features_ready - 1);
+	int32 sf = scheduler_->FrameSubsamplingFactor();
+	if (input_finished) {
+		// if the input has finished, we can compute the last, partial chunk
+		return (features_ready + sf - 1) / sf;
+	} else {
+		int32 non_subsampled_output_frames_ready =
+			std::max<int32>(0, features_ready - scheduler_->RightContext());
+		int32 num_chunks_ready = non_subsampled_output_frames_ready / scheduler_->FramesPerChunk();
+		return num_chunks_ready * scheduler_->FramesPerChunk() / sf;
+	}
+}
+
+bool DecodableNnetBatchOnline::IsLastFrame(int32 subsampled_frame) const {
+	KALDI_ASSERT(subsampled_frame >= 0);
+	int32 num_subsampled_frames_ready = NumFramesReady();
+	bool input_finished = input_features_->IsLastFrame(input_features_->NumFramesReady() - 1);
+	return (input_finished && subsampled_frame == num_subsampled_frames_ready - 1);
+}
+
+BaseFloat DecodableNnetBatchOnline::LogLikelihood(int32 subsampled_frame, int32 transition_id) {
+	EnsureFrameIsComputed(subsampled_frame);
+	return current_log_post_(subsampled_frame - current_log_post_offset_,
+	                         trans_model_.TransitionIdToPdfFast(transition_id));
+}
+
+void DecodableNnetBatchOnline::EnsureFrameIsComputed(int32 subsampled_frame) {
+	if (subsampled_frame >= current_log_post_offset_ &&
+	    subsampled_frame < current_log_post_offset_ + current_log_post_.NumRows())
+		return;
+	// the decoder asks for frames in order, so older chunks are never needed again
+	KALDI_ASSERT(subsampled_frame == current_log_post_offset_ + current_log_post_.NumRows());
+
+	int32 num_frames_ready = NumFramesReady();
+	KALDI_ASSERT(subsampled_frame < num_frames_ready);
+	int32 num_input_frames_ready = input_features_->NumFramesReady();
+	int32 frames_per_task = scheduler_->FramesPerChunk() / scheduler_->FrameSubsamplingFactor();
+	int32 num_frames = num_frames_ready - subsampled_frame;
+	int32 num_tasks = (num_frames + frames_per_task - 1) / frames_per_task;
+
+	// NnetInferenceTask can't be copied, so only ever resize an empty vector
+	tasks_.clear();
+	tasks_.resize(num_tasks);
+	for (int32 i = 0; i < num_tasks; i++) {
+		GetTaskInput(subsampled_frame + i * frames_per_task, num_input_frames_ready, &(tasks_[i]));
+	}
+	scheduler_->Compute(&tasks_);
+
+	current_log_post_.Resize(num_frames, tasks_[0].output_cpu.NumCols(), kUndefined);
+	for (int32 i = 0; i < num_tasks; i++) {
+		// the last task of a finished utterance may have padded output frames
+		int32 num_used = std::min(frames_per_task, num_frames - i * frames_per_task);
+		current_log_post_.RowRange(i * frames_per_task, num_used).CopyFromMat(
+			tasks_[i].output_cpu.RowRange(0, num_used));
+	}
+	current_log_post_offset_ = subsampled_frame;
+	tasks_.clear();
+}
+
+void DecodableNnetBatchOnline::GetTaskInput(int32 subsampled_frame,
+                                            int32 num_input_frames_ready,
+                                            nnet3::NnetInferenceTask *task) {
+	int32 sf = scheduler_->FrameSubsamplingFactor();
+	int32 frames_per_task = scheduler_->FramesPerChunk() / sf;
+	int32 first_input_frame = subsampled_frame * sf - scheduler_->LeftContext();
+	int32 num_input_frames = (frames_per_task - 1) * sf + scheduler_->LeftContext() +
+	                         scheduler_->RightContext() + 1;
+
+	// every task has the same shape, so all streams share one compiled
+	// computation; frames before the start or after the end of the input are
+	// copies of the first or last frame, as in the looped computation
+	Matrix<BaseFloat> input(num_input_frames, input_features_->Dim(), kUndefined);
+	for (int32 i = 0; i < num_input_frames; i++) {
+		int32 t = std::min(std::max(first_input_frame + i, 0), num_input_frames_ready - 1);
+		SubVector<BaseFloat> input_frame(input, i);
+		input_features_->GetFrame(t, &input_frame);
+	}
+	task->input.Swap(&input);
+	task->first_input_t = -scheduler_->LeftContext();
+	task->output_t_stride = sf;
+	task->num_output_frames = frames_per_task;
+	task->num_initial_unused_output_frames = 0;
+	task->num_used_output_frames = frames_per_task;
+	task->is_edge = false;
+	task->is_irregular = false;
+	task->priority = 0.0;
+	task->output_to_cpu = true;
+
+	if (ivector_features_ != NULL) {
+		// use the most recent iVector available for the last input frame
+		int32 ivector_frame = std::min(first_input_frame + num_input_frames - 1,
+		                               ivector_features_->NumFramesReady() - 1);
+		Vector<BaseFloat> ivector(ivector_features_->Dim());
+		ivector_features_->GetFrame(std::max(ivector_frame, 0), &ivector);
+		task->ivector.Resize(ivector.Dim(), kUndefined);
+		task->ivector.CopyFromVec(ivector);
+	}
+}
+
+}
@@ -0,0 +1,110 @@
+// 张; 杨
+#ifndef KALDI_ONLINE_NNET3_BATCH_DECODING_H_
+#define KALDI_ONLINE_NNET3_BATCH_DECODING_H_
+
+#include "online2/online-nnet2-feature-pipeline.h"
+#include "nnet3/nnet-batch-compute.h"
+#include "hmm/transition-model.h"
+#include "itf/decodable-itf.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kaldi {
+
+/// NnetBatchScheduler evaluates acoustic model chunks submitted by many
+/// recognizers as shared minibatches. One scheduler exists per loaded model;
+/// its compute thread waits up to max_wait_ms for a minibatch to fill before
+/// running a partial one, so a lone stream pays at most that much latency.
+class NnetBatchScheduler {
+ public:
+	NnetBatchScheduler(const nnet3::NnetBatchComputerOptions &opts,
+	                   const nnet3::Nnet &nnet,
+	                   const VectorBase<BaseFloat> &priors,
+	                   int32 max_wait_ms);
+	~NnetBatchScheduler();
+
+	// queue the tasks and block until all of them are computed; the outputs
+	// are in (*tasks)[i].output_cpu
+	void Compute(std::vector<nnet3::NnetInferenceTask> *tasks);
+
+	// context in input frames around each output frame, including extra context
+	int32 LeftContext() const { return left_context_; }
+	int32 RightContext() const { return right_context_; }
+	// chunk length in input (non-subsampled) frames
+	int32 FramesPerChunk() const { return opts_.frames_per_chunk; }
+	int32 FrameSubsamplingFactor() const { return opts_.frame_subsampling_factor; }
+
+ private:
+	void ComputeLoop();
+
+	nnet3::NnetBatchComputerOptions opts_;
+	nnet3::NnetBatchComputer computer_;
+	int32 left_context_;
+	int32 right_context_;
+	int32 max_wait_ms_;
+
+	std::mutex pending_mtx_;
+	std::condition_variable pending_cond_;
+	int32 num_pending_;
+	bool finished_;
+	std::thread *compute_thread_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(NnetBatchScheduler);
+};
+
+/// Decodable over an online feature pipeline whose log-likelihoods come from
+/// an NnetBatchScheduler. Like DecodableAmNnetLoopedOnline it only exposes
+/// whole chunks until the input is finished; every ready chunk is submitted at
+/// once, so a stream that is catching up contributes several tasks per batch.
+class DecodableNnetBatchOnline: public DecodableInterface {
+ public:
+	DecodableNnetBatchOnline(const TransitionModel &trans_model,
+	                         NnetBatchScheduler *scheduler,
+	                         OnlineFeatureInterface *input_features,
+	                         OnlineFeatureInterface *ivector_features);
+
+	virtual BaseFloat LogLikelihood(int32 subsampled_frame, int32 transition_id);
+
+	virtual int32 NumFramesReady() const;
+
+	virtual bool IsLastFrame(int32 subsampled_frame) const;
+
+	virtual int32 NumIndices() const { return trans_model_.NumTransitionIds(); }
+
+	int32 FrameSubsamplingFactor() const { return scheduler_->FrameSubsamplingFactor(); }
+
+	// start over on the features of a new utterance
+	void Reset(OnlineFeatureInterface *input_features,
+	           OnlineFeatureInterface *ivector_features);
+
+ private:
+	// compute all chunks that are ready, starting with the one containing
+	// subsampled_frame
+	void EnsureFrameIsComputed(int32 subsampled_frame);
+
+	// fill in the input and iVector of a task whose first output frame is
+	// subsampled_frame; frames outside the available features are replicated
+	void GetTaskInput(int32 subsampled_frame, int32 num_input_frames_ready,
+	                  nnet3::NnetInferenceTask *task);
+
+	const TransitionModel &trans_model_;
+	NnetBatchScheduler *scheduler_;
+	OnlineFeatureInterface *input_features_;
+	OnlineFeatureInterface *ivector_features_;
+
+	// log-likelihoods of the most recently computed chunks, whose first row is
+	// subsampled frame current_log_post_offset_
+	Matrix<BaseFloat> current_log_post_;
+	int32 current_log_post_offset_;
+
+	std::vector<nnet3::NnetInferenceTask> tasks_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableNnetBatchOnline);
+};
+
+}
+
+#endif  // KALDI_ONLINE_NNET3_BATCH_DECODING_H_
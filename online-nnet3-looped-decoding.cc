@@ -0,0 +1,241 @@
+// 张; 杨
+#include "onlinedecoder/online-nnet3-looped-decoding.h"
+#include "nnet3/nnet-utils.h"
+
+namespace kaldi {
+
+LoopedComputationInfo::LoopedComputationInfo(
+	const nnet3::NnetSimpleLoopedComputationOptions &opts,
+	nnet3::AmNnetSimple *am_nnet):
+	opts(opts),
+	nnet(am_nnet->GetNnet()) {
+	SetLogPriors(*am_nnet);
+	// let Kaldi work out the context and compile, then keep what we need
+	nnet3::DecodableNnetSimpleLoopedInfo compiled(this->opts, am_nnet);
+	frames_left_context = compiled.frames_left_context;
+	frames_right_context = compiled.frames_right_context;
+	frames_per_chunk = compiled.frames_per_chunk;
+	output_dim = compiled.output_dim;
+	has_ivectors = compiled.has_ivectors;
+	num_first_chunk_ivectors = 0;
+	num_chunk_ivectors = 0;
+	if (has_ivectors) {
+		KALDI_ASSERT(compiled.request1.inputs.size() == 2 &&
+		             compiled.request2.inputs.size() == 2);
+		num_first_chunk_ivectors = compiled.request1.inputs[1].indexes.size();
+		num_chunk_ivectors = compiled.request2.inputs[1].indexes.size();
+	}
+	computation = compiled.computation;
+}
+
+LoopedComputationInfo::LoopedComputationInfo(
+	const nnet3::NnetSimpleLoopedComputationOptions &opts,
+	nnet3::AmNnetSimple *am_nnet,
+	std::istream &is, bool binary):
+	opts(opts),
+	nnet(am_nnet->GetNnet()) {
+	SetLogPriors(*am_nnet);
+	ExpectToken(is, binary, "<LoopedComputationInfo>");
+	ExpectToken(is, binary, "<FramesLeftContext>");
+	ReadBasicType(is, binary, &frames_left_context);
+	ExpectToken(is, binary, "<FramesRightContext>");
+	ReadBasicType(is, binary, &frames_right_context);
+	ExpectToken(is, binary, "<FramesPerChunk>");
+	ReadBasicType(is, binary, &frames_per_chunk);
+	ExpectToken(is, binary, "<OutputDim>");
+	ReadBasicType(is, binary, &output_dim);
+	ExpectToken(is, binary, "<HasIvectors>");
+	ReadBasicType(is, binary, &has_ivectors);
+	ExpectToken(is, binary, "<NumIvectors>");
+	ReadBasicType(is, binary, &num_first_chunk_ivectors);
+	ReadBasicType(is, binary, &num_chunk_ivectors);
+	computation.Read(is, binary);
+	ExpectToken(is, binary, "</LoopedComputationInfo>");
+	if (output_dim != nnet.OutputDim("output"))
+		KALDI_ERR << "Looped computation does not match the model";
+	// the computation was compiled for an nnet reading iVectors once per chunk
+	if (has_ivectors)
+		nnet3::ModifyNnetIvectorPeriod(frames_per_chunk, &(am_nnet->GetNnet()));
+}
+
+void LoopedComputationInfo::Write(std::ostream &os, bool binary) const {
+	WriteToken(os, binary, "<LoopedComputationInfo>");
+	WriteToken(os, binary, "<FramesLeftContext>");
+	WriteBasicType(os, binary, frames_left_context);
+	WriteToken(os, binary, "<FramesRightContext>");
+	WriteBasicType(os, binary, frames_right_context);
+	WriteToken(os, binary, "<FramesPerChunk>");
+	WriteBasicType(os, binary, frames_per_chunk);
+	WriteToken(os, binary, "<OutputDim>");
+	WriteBasicType(os, binary, output_dim);
+	WriteToken(os, binary, "<HasIvectors>");
+	WriteBasicType(os, binary, has_ivectors);
+	WriteToken(os, binary, "<NumIvectors>");
+	WriteBasicType(os, binary, num_first_chunk_ivectors);
+	WriteBasicType(os, binary, num_chunk_ivectors);
+	computation.Write(os, binary);
+	WriteToken(os, binary, "</LoopedComputationInfo>");
+}
+
+void LoopedComputationInfo::SetLogPriors(const nnet3::AmNnetSimple &am_nnet) {
+	log_priors = am_nnet.Priors();
+	if (log_priors.Dim() != 0)
+		log_priors.ApplyLog();
+}
+
+DecodableLoopedComputationOnline::DecodableLoopedComputationOnline(
+	const TransitionModel &trans_model,
+	const LoopedComputationInfo &info,
+	OnlineFeatureInterface *input_features,
+	OnlineFeatureInterface *ivector_features):
+	trans_model_(trans_model),
+	info_(info),
+	input_features_(NULL),
+	ivector_features_(NULL),
+	num_chunks_computed_(0),
+	current_log_post_subsampled_offset_(-1),
+	computer_(NULL) {
+	Reset(input_features, ivector_features);
+}
+
+DecodableLoopedComputationOnline::~DecodableLoopedComputationOnline() {
+	delete computer_;
+}
+
+void DecodableLoopedComputationOnline::Reset(OnlineFeatureInterface *input_features,
+                                             OnlineFeatureInterface *ivector_features) {
+	input_features_ = input_features;
+	ivector_features_ = ivector_features;
+	KALDI_ASSERT(input_features_ != NULL);
+	int32 feat_ivector_dim = (ivector_features_ != NULL ? ivector_features_->Dim() : -1);
+	if (info_.nnet.InputDim("input") != input_features_->Dim())
+		KALDI_ERR << "Input feature dimension mismatch: got " << input_features_->Dim()
+		          << " but network expects " << info_.nnet.InputDim("input");
+	if (info_.nnet.InputDim("ivector") != feat_ivector_dim)
+		KALDI_ERR << "Ivector feature dimension mismatch: got " << feat_ivector_dim
+		          << " but network expects " << info_.nnet.InputDim("ivector");
+	num_chunks_computed_ = 0;
+	current_log_post_subsampled_offset_ = -1;
+	current_log_post_.Resize(0, 0);
+	delete computer_;
+	computer_ = new nnet3::NnetComputer(info_.opts.compute_config, info_.computation,
+	                                    info_.nnet, NULL);
+}
+
+int32 DecodableLoopedComputationOnline::NumFramesReady() const {
+	int32 features_ready = input_features_->NumFramesReady();
+	if (features_ready == 0)
+		return 0;
+	bool input_finished = input_features_->IsLastFrame(features_ready - 1);
+	int32 sf = info_.opts.frame_subsampling_factor;
+	if (input_finished) {
+		// if the input has finished, the last chunk is padded with copies of
+		// the last frame
+		return (features_ready + sf - 1) / sf;
+	} else {
+		int32 non_subsampled_output_frames_ready =
+			std::max<int32>(0, features_ready - info_.frames_right_context);
+		int32 num_chunks_ready = non_subsampled_output_frames_ready / info_.frames_per_chunk;
+		return num_chunks_ready * info_.frames_per_chunk / sf;
+	}
+}
+
+bool DecodableLoopedComputationOnline::IsLastFrame(int32 subsampled_frame) const {
+	KALDI_ASSERT(subsampled_frame >= 0);
+	int32 num_subsampled_frames_ready = NumFramesReady();
+	bool input_finished = input_features_->IsLastFrame(input_features_->NumFramesReady() - 1);
+	return (input_finished && subsampled_frame == num_subsampled_frames_ready - 1);
+}
+
+BaseFloat DecodableLoopedComputationOnline::LogLikelihood(int32 subsampled_frame,
+                                                          int32 transition_id) {
+	KALDI_ASSERT(subsampled_frame >= current_log_post_subsampled_offset_ &&
+	             "Frames must be accessed in order.");
+	while (subsampled_frame >= current_log_post_subsampled_offset_ + current_log_post_.NumRows())
+		AdvanceChunk();
+	return current_log_post_(subsampled_frame - current_log_post_subsampled_offset_,
+	                         trans_model_.TransitionIdToPdfFast(transition_id));
+}
+
+bool DecodableLoopedComputationOnline::ComputeNextChunk(Matrix<BaseFloat> *log_likes) {
+	int32 frames_per_chunk = info_.frames_per_chunk / info_.opts.frame_subsampling_factor;
+	int32 first_frame = num_chunks_computed_ * frames_per_chunk;
+	// only the last chunk can be shorter, its padding frames are left out
+	int32 num_frames = std::min(frames_per_chunk, NumFramesReady() - first_frame);
+	if (num_frames <= 0)
+		return false;
+	AdvanceChunk();
+	log_likes->Resize(num_frames, current_log_post_.NumCols(), kUndefined);
+	log_likes->CopyFromMat(current_log_post_.RowRange(0, num_frames));
+	return true;
+}
+
+void DecodableLoopedComputationOnline::AdvanceChunk() {
+	// the first chunk has the left context in front of it; after that each
+	// chunk starts where the previous one ended
+	int32 begin_input_frame, end_input_frame;
+	if (num_chunks_computed_ == 0) {
+		begin_input_frame = -info_.frames_left_context;
+		end_input_frame = info_.frames_per_chunk + info_.frames_right_context;
+	} else {
+		begin_input_frame = num_chunks_computed_ * info_.frames_per_chunk +
+		                    info_.frames_right_context;
+		end_input_frame = begin_input_frame + info_.frames_per_chunk;
+	}
+
+	int32 num_feature_frames_ready = input_features_->NumFramesReady();
+	bool is_finished = input_features_->IsLastFrame(num_feature_frames_ready - 1);
+	if (end_input_frame > num_feature_frames_ready && !is_finished)
+		KALDI_ERR << "Attempting to read past end of available features.";
+
+	CuMatrix<BaseFloat> feats_chunk;
+	{
+		Matrix<BaseFloat> this_feats(end_input_frame - begin_input_frame,
+		                             input_features_->Dim(), kUndefined);
+		for (int32 i = begin_input_frame; i < end_input_frame; i++) {
+			SubVector<BaseFloat> this_row(this_feats, i - begin_input_frame);
+			int32 input_frame = std::min(std::max(i, 0), num_feature_frames_ready - 1);
+			input_features_->GetFrame(input_frame, &this_row);
+		}
+		feats_chunk.Swap(&this_feats);
+	}
+	computer_->AcceptInput("input", &feats_chunk);
+
+	if (info_.has_ivectors) {
+		KALDI_ASSERT(ivector_features_ != NULL);
+		int32 num_ivectors = (num_chunks_computed_ == 0 ?
+		                      info_.num_first_chunk_ivectors : info_.num_chunk_ivectors);
+		KALDI_ASSERT(num_ivectors > 0);
+		// use the most recent iVector available for the last input frame
+		Vector<BaseFloat> ivector(ivector_features_->Dim());
+		int32 num_ivector_frames_ready = ivector_features_->NumFramesReady();
+		if (num_ivector_frames_ready > 0)
+			ivector_features_->GetFrame(std::min(num_feature_frames_ready - 1,
+			                                     num_ivector_frames_ready - 1), &ivector);
+		Matrix<BaseFloat> ivectors(num_ivectors, ivector.Dim(), kUndefined);
+		ivectors.CopyRowsFromVec(ivector);
+		CuMatrix<BaseFloat> cu_ivectors;
+		cu_ivectors.Swap(&ivectors);
+		computer_->AcceptInput("ivector", &cu_ivectors);
+	}
+	computer_->Run();
+
+	CuMatrix<BaseFloat> output;
+	computer_->GetOutputDestructive("output", &output);
+	if (info_.log_priors.Dim() != 0) {
+		// subtract log-prior (divide by prior)
+		output.AddVecToRows(-1.0, info_.log_priors);
+	}
+	output.Scale(info_.opts.acoustic_scale);
+	current_log_post_.Resize(0, 0);
+	output.Swap(&current_log_post_);
+	KALDI_ASSERT(current_log_post_.NumRows() ==
+	             info_.frames_per_chunk / info_.opts.frame_subsampling_factor &&
+	             current_log_post_.NumCols() == info_.output_dim);
+
+	num_chunks_computed_++;
+	current_log_post_subsampled_offset_ = (num_chunks_computed_ - 1) *
+		(info_.frames_per_chunk / info_.opts.frame_subsampling_factor);
+}
+
+}
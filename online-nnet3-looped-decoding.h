@@ -0,0 +1,107 @@
+// 张; 杨
+#ifndef KALDI_ONLINE_NNET3_LOOPED_DECODING_H_
+#define KALDI_ONLINE_NNET3_LOOPED_DECODING_H_
+
+#include "nnet3/decodable-simple-looped.h"
+#include "nnet3/am-nnet-simple.h"
+#include "nnet3/nnet-compute.h"
+#include "itf/online-feature-itf.h"
+#include "itf/decodable-itf.h"
+#include "hmm/transition-model.h"
+
+namespace kaldi {
+
+/// The parts of DecodableNnetSimpleLoopedInfo that are used while decoding.
+/// Unlike the Kaldi class it can be written to and read back from a stream,
+/// so the looped computation only has to be compiled once per model and
+/// options instead of once per process.
+struct LoopedComputationInfo {
+	nnet3::NnetSimpleLoopedComputationOptions opts;
+	const nnet3::Nnet &nnet;
+
+	int32 frames_left_context;
+	int32 frames_right_context;
+	// chunk length in input frames, a multiple of the subsampling factor
+	int32 frames_per_chunk;
+	int32 output_dim;
+	bool has_ivectors;
+	// number of iVectors the computation takes for the first chunk and for
+	// each later chunk
+	int32 num_first_chunk_ivectors;
+	int32 num_chunk_ivectors;
+
+	CuVector<BaseFloat> log_priors;
+	nnet3::NnetComputation computation;
+
+	// compile the looped computation; if the nnet takes iVectors it is
+	// modified to read them once per chunk, as DecodableNnetSimpleLoopedInfo does
+	LoopedComputationInfo(const nnet3::NnetSimpleLoopedComputationOptions &opts,
+	                      nnet3::AmNnetSimple *am_nnet);
+
+	// read a computation written by Write() for the same model and options,
+	// and modify the nnet the same way
+	LoopedComputationInfo(const nnet3::NnetSimpleLoopedComputationOptions &opts,
+	                      nnet3::AmNnetSimple *am_nnet,
+	                      std::istream &is, bool binary);
+
+	void Write(std::ostream &os, bool binary) const;
+
+ private:
+	void SetLogPriors(const nnet3::AmNnetSimple &am_nnet);
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(LoopedComputationInfo);
+};
+
+/// DecodableAmNnetLoopedOnline over a LoopedComputationInfo.
+/// Reference: DecodableNnetLoopedOnlineBase, DecodableAmNnetLoopedOnline
+class DecodableLoopedComputationOnline: public DecodableInterface {
+ public:
+	DecodableLoopedComputationOnline(const TransitionModel &trans_model,
+	                                 const LoopedComputationInfo &info,
+	                                 OnlineFeatureInterface *input_features,
+	                                 OnlineFeatureInterface *ivector_features);
+	~DecodableLoopedComputationOnline();
+
+	/// start over on the features of a new utterance; the looped computation
+	/// restarts from its first chunk, on a new NnetComputer since Kaldi's
+	/// can't be rewound
+	void Reset(OnlineFeatureInterface *input_features,
+	           OnlineFeatureInterface *ivector_features);
+
+	virtual BaseFloat LogLikelihood(int32 subsampled_frame, int32 transition_id);
+
+	virtual int32 NumFramesReady() const;
+
+	virtual bool IsLastFrame(int32 subsampled_frame) const;
+
+	virtual int32 NumIndices() const { return trans_model_.NumTransitionIds(); }
+
+	int32 FrameSubsamplingFactor() const { return info_.opts.frame_subsampling_factor; }
+
+	/// run the computation for the next chunk if its features are ready and
+	/// copy the log-likelihoods of its frames to log_likes, one column per pdf;
+	/// false if they are not ready. Not to be mixed with LogLikelihood.
+	bool ComputeNextChunk(Matrix<BaseFloat> *log_likes);
+
+ private:
+	// run the computation for the next chunk
+	void AdvanceChunk();
+
+	const TransitionModel &trans_model_;
+	const LoopedComputationInfo &info_;
+	OnlineFeatureInterface *input_features_;
+	OnlineFeatureInterface *ivector_features_;
+
+	int32 num_chunks_computed_;
+	// the first row of current_log_post_ is this subsampled frame
+	int32 current_log_post_subsampled_offset_;
+	Matrix<BaseFloat> current_log_post_;
+
+	nnet3::NnetComputer *computer_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableLoopedComputationOnline);
+};
+
+}
+
+#endif  // KALDI_ONLINE_NNET3_LOOPED_DECODING_H_
@@ -0,0 +1,105 @@
+// 张; 杨
+#include "onlinedecoder/online-nnet3-pipelined-decoding.h"
+
+namespace kaldi {
+
+DecodableNnetPipelinedOnline::DecodableNnetPipelinedOnline(
+	const TransitionModel &trans_model, int32 max_queued_frames):
+	trans_model_(trans_model),
+	max_queued_frames_(max_queued_frames),
+	num_frames_queued_(0),
+	cancelled_(false),
+	num_frames_ready_(0),
+	input_finished_(false),
+	current_(NULL) {
+	KALDI_ASSERT(max_queued_frames_ > 0);
+}
+
+DecodableNnetPipelinedOnline::~DecodableNnetPipelinedOnline() {
+	this->Reset();
+	for (size_t i = 0; i < spare_chunks_.size(); i++)
+		delete spare_chunks_[i];
+}
+
+void DecodableNnetPipelinedOnline::Reset() {
+	std::lock_guard<std::mutex> queue_locker(queue_mtx_);
+	if (current_ != NULL)
+		spare_chunks_.push_back(current_);
+	current_ = NULL;
+	spare_chunks_.insert(spare_chunks_.end(), queue_.begin(), queue_.end());
+	queue_.clear();
+	num_frames_queued_ = 0;
+	cancelled_ = false;
+	num_frames_ready_ = 0;
+	input_finished_ = false;
+}
+
+bool DecodableNnetPipelinedOnline::Push(Matrix<BaseFloat> *log_likes) {
+	std::unique_lock<std::mutex> queue_locker(queue_mtx_);
+	not_full_cond_.wait(queue_locker, [this] {
+		return this->num_frames_queued_ < this->max_queued_frames_ || this->cancelled_; });
+	if (cancelled_)
+		return false;
+	Chunk *chunk;
+	if (!spare_chunks_.empty()) {
+		chunk = spare_chunks_.back();
+		spare_chunks_.pop_back();
+	} else {
+		chunk = new Chunk();
+	}
+	chunk->first_frame = num_frames_ready_;
+	chunk->log_likes.Swap(log_likes);
+	int32 num_frames = chunk->log_likes.NumRows();
+	queue_.push_back(chunk);
+	num_frames_queued_ += num_frames;
+	num_frames_ready_ += num_frames;
+	ready_cond_.notify_one();
+	return true;
+}
+
+void DecodableNnetPipelinedOnline::InputFinished() {
+	std::lock_guard<std::mutex> queue_locker(queue_mtx_);
+	input_finished_ = true;
+	ready_cond_.notify_one();
+}
+
+bool DecodableNnetPipelinedOnline::WaitForFrames(int32 num_frames_decoded) {
+	std::unique_lock<std::mutex> queue_locker(queue_mtx_);
+	ready_cond_.wait(queue_locker, [this, num_frames_decoded] {
+		return this->num_frames_ready_ > num_frames_decoded || this->input_finished_ ||
+		       this->cancelled_; });
+	return num_frames_ready_ > num_frames_decoded && !cancelled_;
+}
+
+void DecodableNnetPipelinedOnline::Cancel() {
+	std::lock_guard<std::mutex> queue_locker(queue_mtx_);
+	cancelled_ = true;
+	not_full_cond_.notify_one();
+	ready_cond_.notify_one();
+}
+
+bool DecodableNnetPipelinedOnline::IsLastFrame(int32 frame) const {
+	return input_finished_ && frame == num_frames_ready_ - 1;
+}
+
+BaseFloat DecodableNnetPipelinedOnline::LogLikelihood(int32 frame, int32 transition_id) {
+	// the decoder asks for the frames in order, so a frame past the current
+	// chunk is in the next one
+	while (current_ == NULL || frame >= current_->first_frame + current_->log_likes.NumRows())
+		NextChunk();
+	return current_->log_likes(frame - current_->first_frame,
+	                           trans_model_.TransitionIdToPdfFast(transition_id));
+}
+
+void DecodableNnetPipelinedOnline::NextChunk() {
+	std::lock_guard<std::mutex> queue_locker(queue_mtx_);
+	if (current_ != NULL)
+		spare_chunks_.push_back(current_);
+	KALDI_ASSERT(!queue_.empty() && "Frames must be ready before they are decoded.");
+	current_ = queue_.front();
+	queue_.pop_front();
+	num_frames_queued_ -= current_->log_likes.NumRows();
+	not_full_cond_.notify_one();
+}
+
+}
@@ -0,0 +1,84 @@
+// 张; 杨
+#ifndef KALDI_ONLINE_NNET3_PIPELINED_DECODING_H_
+#define KALDI_ONLINE_NNET3_PIPELINED_DECODING_H_
+
+#include "matrix/kaldi-matrix.h"
+#include "hmm/transition-model.h"
+#include "itf/decodable-itf.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace kaldi {
+
+/// Decodable fed by another thread: a feature thread computes the acoustic
+/// model and pushes the log-likelihoods of whole chunks, while the search
+/// thread decodes the frames already pushed. The queue is bounded, so the
+/// feature thread waits when it gets too far ahead of the search.
+/// Reference: SingleUtteranceNnet2DecoderThreaded
+class DecodableNnetPipelinedOnline: public DecodableInterface {
+ public:
+	// the feature thread waits while max_queued_frames frames are queued
+	DecodableNnetPipelinedOnline(const TransitionModel &trans_model,
+	                             int32 max_queued_frames);
+	~DecodableNnetPipelinedOnline();
+
+	// start a new utterance; neither thread may be using the queue
+	void Reset();
+
+	// feature thread: append the next frames, one row per frame and one column
+	// per pdf. log_likes is swapped with a matrix no longer used, so its
+	// memory is reused. Returns false if the search has cancelled.
+	bool Push(Matrix<BaseFloat> *log_likes);
+	// feature thread: no more frames will be pushed
+	void InputFinished();
+
+	// search thread: wait until a frame after the first num_frames_decoded is
+	// ready; false if none will be because the input has finished
+	bool WaitForFrames(int32 num_frames_decoded);
+	// search thread: make the current and every later Push return false
+	void Cancel();
+
+	virtual BaseFloat LogLikelihood(int32 frame, int32 transition_id);
+
+	virtual int32 NumFramesReady() const { return num_frames_ready_; }
+
+	virtual bool IsLastFrame(int32 frame) const;
+
+	virtual int32 NumIndices() const { return trans_model_.NumTransitionIds(); }
+
+ private:
+	struct Chunk {
+		int32 first_frame;
+		Matrix<BaseFloat> log_likes;
+	};
+
+	// search thread: move on to the next chunk in the queue
+	void NextChunk();
+
+	const TransitionModel &trans_model_;
+	int32 max_queued_frames_;
+
+	std::mutex queue_mtx_;
+	std::condition_variable not_full_cond_;
+	std::condition_variable ready_cond_;
+	std::deque<Chunk*> queue_;
+	std::vector<Chunk*> spare_chunks_;
+	// frames in queue_, not counting the chunk being decoded
+	int32 num_frames_queued_;
+	bool cancelled_;
+
+	std::atomic<int32> num_frames_ready_;
+	std::atomic<bool> input_finished_;
+	// the chunk being decoded, only used by the search thread
+	Chunk *current_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableNnetPipelinedOnline);
+};
+
+}
+
+#endif  // KALDI_ONLINE_NNET3_PIPELINED_DECODING_H_
@@ -0,0 +1,124 @@
+// 张; 杨
+#include "onlinedecoder/online-nnet3-stream-decoding.h"
+
+namespace kaldi {
+
+// Reference: SingleUtteranceNnet3Decoder
+OnlineNnet3StreamDecoder::OnlineNnet3StreamDecoder(
+	const LatticeFasterDecoderConfig &decoder_opts,
+	const TransitionModel &trans_model,
+	const LoopedComputationInfo *info,
+	NnetBatchScheduler *scheduler,
+	const fst::Fst<fst::StdArc> &fst,
+	int32 max_queued_frames,
+	StreamSearchType search_type):
+	decoder_opts_(decoder_opts),
+	input_feature_frame_shift_in_seconds_(0.0),
+	trans_model_(trans_model),
+	info_(info),
+	scheduler_(scheduler),
+	looped_decodable_(NULL),
+	batch_decodable_(NULL),
+	pipelined_decodable_(NULL),
+	decodable_(NULL),
+	search_(NULL) {
+	KALDI_ASSERT((info_ == NULL) != (scheduler_ == NULL));
+	if (search_type == kOneBestSearch)
+		search_ = new OneBestStreamSearch(decoder_opts_, trans_model_, fst);
+	else
+		search_ = new LatticeStreamSearch(decoder_opts_, trans_model_, fst);
+	if (max_queued_frames > 0) {
+		KALDI_ASSERT(info_ != NULL && "Pipelined decoding needs the looped computation");
+		pipelined_decodable_ = new DecodableNnetPipelinedOnline(trans_model_, max_queued_frames);
+	}
+}
+
+OnlineNnet3StreamDecoder::~OnlineNnet3StreamDecoder() {
+	delete looped_decodable_;
+	delete batch_decodable_;
+	delete pipelined_decodable_;
+	delete search_;
+}
+
+void OnlineNnet3StreamDecoder::InitDecoding(OnlineStreamFeaturePipeline *features) {
+	input_feature_frame_shift_in_seconds_ = features->FrameShiftInSeconds();
+	if (scheduler_ != NULL) {
+		if (batch_decodable_ == NULL)
+			batch_decodable_ = new DecodableNnetBatchOnline(trans_model_, scheduler_,
+			                                                features->InputFeature(),
+			                                                features->IvectorFeature());
+		else
+			batch_decodable_->Reset(features->InputFeature(), features->IvectorFeature());
+		decodable_ = batch_decodable_;
+	} else {
+		if (looped_decodable_ == NULL)
+			looped_decodable_ = new DecodableLoopedComputationOnline(
+				trans_model_, *info_, features->InputFeature(), features->IvectorFeature());
+		else
+			looped_decodable_->Reset(features->InputFeature(), features->IvectorFeature());
+		decodable_ = looped_decodable_;
+		if (pipelined_decodable_ != NULL) {
+			pipelined_decodable_->Reset();
+			decodable_ = pipelined_decodable_;
+		}
+	}
+	search_->InitDecoding();
+}
+
+void OnlineNnet3StreamDecoder::AdvanceDecoding() {
+	search_->AdvanceDecoding(decodable_);
+}
+
+bool OnlineNnet3StreamDecoder::ComputeReadyFrames(bool input_finished) {
+	KALDI_ASSERT(Pipelined());
+	while (looped_decodable_->ComputeNextChunk(&pipeline_log_likes_)) {
+		if (!pipelined_decodable_->Push(&pipeline_log_likes_))
+			return false;
+	}
+	if (input_finished)
+		pipelined_decodable_->InputFinished();
+	return true;
+}
+
+bool OnlineNnet3StreamDecoder::WaitForFrames() {
+	return pipelined_decodable_->WaitForFrames(search_->NumFramesDecoded());
+}
+
+void OnlineNnet3StreamDecoder::CancelPipeline() {
+	pipelined_decodable_->Cancel();
+}
+
+void OnlineNnet3StreamDecoder::FinalizeDecoding() {
+	search_->FinalizeDecoding();
+}
+
+int32 OnlineNnet3StreamDecoder::NumFramesDecoded() const {
+	return search_->NumFramesDecoded();
+}
+
+void OnlineNnet3StreamDecoder::GetLattice(bool end_of_utterance,
+                                          CompactLattice *clat) const {
+	search_->GetLattice(end_of_utterance, clat);
+}
+
+void OnlineNnet3StreamDecoder::GetBestPath(bool end_of_utterance,
+                                           Lattice *best_path) const {
+	search_->GetBestPath(end_of_utterance, best_path);
+}
+
+const std::vector<int32> &OnlineNnet3StreamDecoder::TraceBackPartial(int32 *num_unchanged) {
+	return search_->TraceBackPartial(num_unchanged);
+}
+
+int32 OnlineNnet3StreamDecoder::FrameSubsamplingFactor() const {
+	if (scheduler_ != NULL)
+		return scheduler_->FrameSubsamplingFactor();
+	return info_->opts.frame_subsampling_factor;
+}
+
+bool OnlineNnet3StreamDecoder::EndpointDetected(
+	const OnlineEndpointConfig &config) {
+	return search_->EndpointDetected(config, FrameShiftInSeconds());
+}
+
+}
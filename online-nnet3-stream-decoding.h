@@ -0,0 +1,129 @@
+// 张; 杨
+#ifndef KALDI_ONLINE_NNET3_STREAM_DECODING_H_
+#define KALDI_ONLINE_NNET3_STREAM_DECODING_H_
+
+#include "onlinedecoder/online-feature-pipeline.h"
+#include "online2/online-endpoint.h"
+#include "onlinedecoder/online-nnet3-looped-decoding.h"
+#include "onlinedecoder/online-stream-search.h"
+#include "onlinedecoder/online-nnet3-batch-decoding.h"
+#include "onlinedecoder/online-nnet3-pipelined-decoding.h"
+
+namespace kaldi {
+
+/// Long-lived counterpart of SingleUtteranceNnet3Decoder. One exists per
+/// recognizer and decodes all of its utterances: InitDecoding starts a new
+/// utterance on a new feature pipeline while the decoder keeps its token
+/// storage, and the decodable is re-targeted instead of rebuilt.
+/// The acoustic scores come from the looped computation or, when a
+/// scheduler is given, from the shared NnetBatchScheduler.
+/// In pipelined mode the looped computation runs on a feature thread, see
+/// ComputeReadyFrames, and the search decodes the frames it has queued.
+/// The search itself is a StreamSearch, with or without a lattice.
+class OnlineNnet3StreamDecoder {
+ public:
+	// exactly one of info and scheduler is non-NULL; max_queued_frames > 0
+	// selects pipelined mode, which needs info
+	OnlineNnet3StreamDecoder(const LatticeFasterDecoderConfig &decoder_opts,
+	                         const TransitionModel &trans_model,
+	                         const LoopedComputationInfo *info,
+	                         NnetBatchScheduler *scheduler,
+	                         const fst::Fst<fst::StdArc> &fst,
+	                         int32 max_queued_frames = 0,
+	                         StreamSearchType search_type = kLatticeSearch);
+	~OnlineNnet3StreamDecoder();
+
+	/// start decoding a new utterance whose features come from features;
+	/// the pipeline must outlive the utterance
+	void InitDecoding(OnlineStreamFeaturePipeline *features);
+
+	/// advance the decoding as far as we can.
+	void AdvanceDecoding();
+
+	bool Pipelined() const { return pipelined_decodable_ != NULL; }
+
+	/// Pipelined mode, on the feature thread: compute the acoustic model on
+	/// every chunk whose features are ready and queue their frames, waiting
+	/// while the queue is full. With input_finished the features must be
+	/// finished, and the search is told that no frames follow. Returns false
+	/// once the search has cancelled.
+	bool ComputeReadyFrames(bool input_finished);
+
+	/// Pipelined mode, on the search thread: wait for frames to decode, false
+	/// when all frames are decoded and the input has finished.
+	bool WaitForFrames();
+
+	/// Pipelined mode, on the search thread: stop the feature thread, which
+	/// returns from ComputeReadyFrames without queueing more frames.
+	void CancelPipeline();
+
+	/// Finalizes the decoding. Cleans up and prunes remaining tokens, so the
+	/// GetLattice() call will return faster.
+	void FinalizeDecoding();
+
+	int32 NumFramesDecoded() const;
+
+	/// seconds of audio per decoded frame, known after InitDecoding
+	BaseFloat FrameShiftInSeconds() const {
+		return input_feature_frame_shift_in_seconds_ * FrameSubsamplingFactor();
+	}
+
+	int32 NumActiveTokens() const { return search_->NumActiveTokens(); }
+
+	/// Gets the lattice, see SingleUtteranceNnet3Decoder::GetLattice. Without
+	/// a lattice search it is the lattice of the best path.
+	void GetLattice(bool end_of_utterance, CompactLattice *clat) const;
+
+	/// Outputs an FST corresponding to the single best path through the current
+	/// lattice.
+	void GetBestPath(bool end_of_utterance, Lattice *best_path) const;
+
+	/// Words on the current best path, without final probs, for partial
+	/// results. With the lattice search the traceback stops where it joins
+	/// the path of the previous call, so its cost depends on how much of the
+	/// path changed rather than on the length of the utterance. The first
+	/// *num_unchanged words are the same as in the previous call.
+	const std::vector<int32> &TraceBackPartial(int32 *num_unchanged);
+
+	/// This function calls EndpointDetected from online-endpoint.h,
+	/// with the required arguments.
+	bool EndpointDetected(const OnlineEndpointConfig &config);
+
+	/// false if the search can't give silence weighting its traceback
+	bool SupportsSilenceWeighting() const { return search_->SupportsSilenceWeighting(); }
+
+	/// see OnlineSilenceWeighting::ComputeCurrentTraceback
+	void ComputeSilenceTraceback(OnlineSilenceWeighting *silence_weighting) {
+		search_->ComputeSilenceTraceback(silence_weighting);
+	}
+
+ private:
+	int32 FrameSubsamplingFactor() const;
+
+	const LatticeFasterDecoderConfig &decoder_opts_;
+
+	// derived from calling FrameShiftInSeconds() on the feature pipeline of
+	// the current utterance
+	BaseFloat input_feature_frame_shift_in_seconds_;
+
+	const TransitionModel &trans_model_;
+	const LoopedComputationInfo *info_;
+	NnetBatchScheduler *scheduler_;
+
+	// created for the first utterance and reset on the features of each
+	// later one
+	DecodableLoopedComputationOnline *looped_decodable_;
+	DecodableNnetBatchOnline *batch_decodable_;
+	// pipelined mode: the frames computed by the feature thread
+	DecodableNnetPipelinedOnline *pipelined_decodable_;
+	Matrix<BaseFloat> pipeline_log_likes_;
+	DecodableInterface *decodable_;
+
+	StreamSearch *search_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineNnet3StreamDecoder);
+};
+
+}
+
+#endif  // KALDI_ONLINE_NNET3_STREAM_DECODING_H_
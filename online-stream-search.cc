@@ -0,0 +1,247 @@
+// 张; 杨
+#include "onlinedecoder/online-stream-search.h"
+#include "lat/determinize-lattice-pruned.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace kaldi {
+
+bool ParseStreamSearchType(const std::string &str, StreamSearchType *type) {
+	if (str == "lattice") {
+		*type = kLatticeSearch;
+		return true;
+	}
+	if (str == "one-best") {
+		*type = kOneBestSearch;
+		return true;
+	}
+	return false;
+}
+
+LatticeStreamSearch::LatticeStreamSearch(const LatticeFasterDecoderConfig &decoder_opts,
+                                         const TransitionModel &trans_model,
+                                         const fst::Fst<fst::StdArc> &fst):
+	decoder_opts_(decoder_opts),
+	trans_model_(trans_model),
+	decoder_(fst, decoder_opts) {
+}
+
+void LatticeStreamSearch::InitDecoding() {
+	// reuses the token and lattice storage of the previous utterance
+	this->decoder_.InitDecoding();
+	this->traceback_.clear();
+	this->traceback_words_.clear();
+	this->traceback_frame_start_.clear();
+}
+
+void LatticeStreamSearch::GetLattice(bool end_of_utterance, CompactLattice *clat) {
+	if (this->NumFramesDecoded() == 0)
+		KALDI_ERR << "You cannot get a lattice if you decoded no frames.";
+	Lattice raw_lat;
+	this->decoder_.GetRawLattice(&raw_lat, end_of_utterance);
+
+	if (!this->decoder_opts_.determinize_lattice)
+		KALDI_ERR << "--determinize-lattice=false option is not supported at the moment";
+
+	BaseFloat lat_beam = this->decoder_opts_.lattice_beam;
+	DeterminizeLatticePhonePrunedWrapper(
+		this->trans_model_, &raw_lat, lat_beam, clat, this->decoder_opts_.det_opts);
+}
+
+void LatticeStreamSearch::GetBestPath(bool end_of_utterance, Lattice *best_path) {
+	this->decoder_.GetBestPath(best_path, end_of_utterance);
+}
+
+int32 LatticeStreamSearch::FindInTraceback(const void *tok, int32 frame) const {
+	size_t index = frame + 1;
+	if (index >= this->traceback_frame_start_.size())
+		return -1;
+	for (size_t i = this->traceback_frame_start_[index];
+	     i < this->traceback_.size() && this->traceback_[i].frame == frame; i++) {
+		if (this->traceback_[i].tok == tok)
+			return i;
+	}
+	return -1;
+}
+
+// Reference: LatticeFasterOnlineDecoder::GetBestPath
+const std::vector<int32> &LatticeStreamSearch::TraceBackPartial(int32 *num_unchanged) {
+	// trace back until the path joins the previous one, collecting the
+	// tokens and the word on the arc into each of them, newest first
+	std::vector<TracebackEntry> suffix;
+	std::vector<int32> suffix_words;
+	int32 join = -1;
+	LatticeFasterOnlineDecoder::BestPathIterator iter = this->decoder_.BestPathEnd(false);
+	while (!iter.Done()) {
+		join = this->FindInTraceback(iter.tok, iter.frame);
+		if (join >= 0)
+			break;
+		TracebackEntry entry;
+		entry.tok = iter.tok;
+		entry.frame = iter.frame;
+		suffix.push_back(entry);
+		LatticeArc arc;
+		iter = this->decoder_.TraceBackBestPath(iter, &arc);
+		suffix_words.push_back(arc.olabel);
+	}
+
+	// keep the shared prefix and append the new part in order
+	if (join >= 0) {
+		this->traceback_.resize(join + 1);
+		this->traceback_words_.resize(this->traceback_[join].num_words);
+		this->traceback_frame_start_.resize(this->traceback_[join].frame + 2);
+	} else {
+		this->traceback_.clear();
+		this->traceback_words_.clear();
+		this->traceback_frame_start_.clear();
+	}
+	*num_unchanged = this->traceback_words_.size();
+	for (int32 i = static_cast<int32>(suffix.size()) - 1; i >= 0; i--) {
+		if (suffix_words[i] != 0)
+			this->traceback_words_.push_back(suffix_words[i]);
+		suffix[i].num_words = this->traceback_words_.size();
+		while (static_cast<int32>(this->traceback_frame_start_.size()) <= suffix[i].frame + 1)
+			this->traceback_frame_start_.push_back(this->traceback_.size());
+		this->traceback_.push_back(suffix[i]);
+	}
+	return this->traceback_words_;
+}
+
+bool LatticeStreamSearch::EndpointDetected(const OnlineEndpointConfig &config,
+                                           BaseFloat frame_shift_in_seconds) {
+	return kaldi::EndpointDetected(config, this->trans_model_, frame_shift_in_seconds,
+	                               this->decoder_);
+}
+
+void LatticeStreamSearch::ComputeSilenceTraceback(OnlineSilenceWeighting *silence_weighting) {
+	const LatticeFasterOnlineDecoder &decoder = this->decoder_;
+	silence_weighting->ComputeCurrentTraceback(decoder);
+}
+
+int32 StreamFasterDecoder::NumActiveTokens() const {
+	int32 num_toks = 0;
+	for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail)
+		num_toks++;
+	return num_toks;
+}
+
+const StreamFasterDecoder::Token *StreamFasterDecoder::BestToken() const {
+	const Token *best_tok = NULL;
+	for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
+		if (best_tok == NULL || e->val->cost_ < best_tok->cost_)
+			best_tok = e->val;
+	}
+	return best_tok;
+}
+
+void StreamFasterDecoder::BestPathWords(std::vector<int32> *words) const {
+	words->clear();
+	for (const Token *tok = this->BestToken(); tok != NULL; tok = tok->prev_) {
+		if (tok->arc_.olabel != 0)
+			words->push_back(tok->arc_.olabel);
+	}
+	std::reverse(words->begin(), words->end());
+}
+
+int32 StreamFasterDecoder::TrailingSilenceFrames(const TransitionModel &trans_model,
+                                                 const std::vector<int32> &silence_phones) const {
+	int32 num_sil_frames = 0;
+	for (const Token *tok = this->BestToken(); tok != NULL; tok = tok->prev_) {
+		int32 transition_id = tok->arc_.ilabel;
+		if (transition_id == 0)
+			continue;
+		int32 phone = trans_model.TransitionIdToPhone(transition_id);
+		if (!std::binary_search(silence_phones.begin(), silence_phones.end(), phone))
+			break;
+		num_sil_frames++;
+	}
+	return num_sil_frames;
+}
+
+BaseFloat StreamFasterDecoder::FinalRelativeCost() const {
+	double infinity = std::numeric_limits<double>::infinity();
+	double best_cost = infinity, best_cost_with_final = infinity;
+	for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
+		double cost = e->val->cost_;
+		best_cost = std::min(best_cost, cost);
+		best_cost_with_final = std::min(best_cost_with_final, cost + fst_.Final(e->key).Value());
+	}
+	if (best_cost == infinity || best_cost_with_final == infinity)
+		return infinity;
+	return best_cost_with_final - best_cost;
+}
+
+OneBestStreamSearch::OneBestStreamSearch(const LatticeFasterDecoderConfig &decoder_opts,
+                                         const TransitionModel &trans_model,
+                                         const fst::Fst<fst::StdArc> &fst):
+	trans_model_(trans_model),
+	decoder_(fst, FasterOptions(decoder_opts)) {
+}
+
+FasterDecoderOptions OneBestStreamSearch::FasterOptions(
+	const LatticeFasterDecoderConfig &decoder_opts) {
+	FasterDecoderOptions opts;
+	opts.beam = decoder_opts.beam;
+	opts.max_active = decoder_opts.max_active;
+	opts.min_active = decoder_opts.min_active;
+	opts.beam_delta = decoder_opts.beam_delta;
+	opts.hash_ratio = decoder_opts.hash_ratio;
+	return opts;
+}
+
+void OneBestStreamSearch::InitDecoding() {
+	this->decoder_.InitDecoding();
+	this->partial_words_.clear();
+}
+
+void OneBestStreamSearch::GetLattice(bool end_of_utterance, CompactLattice *clat) {
+	if (this->NumFramesDecoded() == 0)
+		KALDI_ERR << "You cannot get a lattice if you decoded no frames.";
+	Lattice best_path;
+	this->decoder_.GetBestPath(&best_path, end_of_utterance);
+	ConvertLattice(best_path, clat);
+}
+
+void OneBestStreamSearch::GetBestPath(bool end_of_utterance, Lattice *best_path) {
+	this->decoder_.GetBestPath(best_path, end_of_utterance);
+}
+
+// FasterDecoder tokens have no frame index and are freed once off every
+// surviving path, so the path can't be matched against the previous one by
+// token as in the lattice search; the words are compared instead
+const std::vector<int32> &OneBestStreamSearch::TraceBackPartial(int32 *num_unchanged) {
+	this->decoder_.BestPathWords(&this->new_partial_words_);
+	size_t num_same = 0;
+	while (num_same < this->partial_words_.size() &&
+	       num_same < this->new_partial_words_.size() &&
+	       this->partial_words_[num_same] == this->new_partial_words_[num_same])
+		num_same++;
+	*num_unchanged = num_same;
+	this->partial_words_.swap(this->new_partial_words_);
+	return this->partial_words_;
+}
+
+// Reference: EndpointDetected
+bool OneBestStreamSearch::EndpointDetected(const OnlineEndpointConfig &config,
+                                           BaseFloat frame_shift_in_seconds) {
+	if (config.silence_phones != this->silence_phones_str_) {
+		this->silence_phones_.clear();
+		if (!SplitStringToIntegers(config.silence_phones, ":", false, &this->silence_phones_))
+			KALDI_ERR << "Bad --silence-phones option in endpointing config: "
+			          << config.silence_phones;
+		std::sort(this->silence_phones_.begin(), this->silence_phones_.end());
+		this->silence_phones_str_ = config.silence_phones;
+	}
+	int32 num_frames_decoded = this->decoder_.NumFramesDecoded(),
+		trailing_silence_frames = this->decoder_.TrailingSilenceFrames(this->trans_model_,
+		                                                               this->silence_phones_);
+	return kaldi::EndpointDetected(config, num_frames_decoded, trailing_silence_frames,
+	                               frame_shift_in_seconds, this->decoder_.FinalRelativeCost());
+}
+
+void OneBestStreamSearch::ComputeSilenceTraceback(OnlineSilenceWeighting *silence_weighting) {
+	KALDI_ERR << "Silence weighting needs decoder-type=lattice";
+}
+
+}
@@ -0,0 +1,191 @@
+// 张; 杨
+#ifndef KALDI_ONLINE_STREAM_SEARCH_H_
+#define KALDI_ONLINE_STREAM_SEARCH_H_
+
+#include "decoder/lattice-faster-online-decoder.h"
+#include "decoder/faster-decoder.h"
+#include "online2/online-endpoint.h"
+#include "online2/online-ivector-feature.h"
+#include "itf/decodable-itf.h"
+#include "hmm/transition-model.h"
+
+#include <string>
+#include <vector>
+
+namespace kaldi {
+
+enum StreamSearchType {
+	kLatticeSearch,
+	kOneBestSearch
+};
+
+// parses "lattice" or "one-best"
+bool ParseStreamSearchType(const std::string &str, StreamSearchType *type);
+
+/// The search of OnlineNnet3StreamDecoder, so the same decoder core can run
+/// either the lattice search or the cheaper one-best search. The calls are
+/// per chunk, the per-frame work stays inside the Kaldi decoders.
+class StreamSearch {
+ public:
+	virtual ~StreamSearch() {}
+
+	/// start a new utterance, reusing the storage of the previous one
+	virtual void InitDecoding() = 0;
+
+	virtual void AdvanceDecoding(DecodableInterface *decodable) = 0;
+
+	virtual void FinalizeDecoding() = 0;
+
+	virtual int32 NumFramesDecoded() const = 0;
+
+	virtual int32 NumActiveTokens() const = 0;
+
+	/// see SingleUtteranceNnet3Decoder::GetLattice; the one-best search gives
+	/// the lattice of its best path
+	virtual void GetLattice(bool end_of_utterance, CompactLattice *clat) = 0;
+
+	virtual void GetBestPath(bool end_of_utterance, Lattice *best_path) = 0;
+
+	/// see OnlineNnet3StreamDecoder::TraceBackPartial
+	virtual const std::vector<int32> &TraceBackPartial(int32 *num_unchanged) = 0;
+
+	virtual bool EndpointDetected(const OnlineEndpointConfig &config,
+	                              BaseFloat frame_shift_in_seconds) = 0;
+
+	/// false if the traceback of this search can't be used for silence
+	/// weighting
+	virtual bool SupportsSilenceWeighting() const = 0;
+
+	virtual void ComputeSilenceTraceback(OnlineSilenceWeighting *silence_weighting) = 0;
+};
+
+/// LatticeFasterOnlineDecoder with its token count made public, for the
+/// recognizer statistics.
+class StreamLatticeDecoder: public LatticeFasterOnlineDecoder {
+ public:
+	StreamLatticeDecoder(const fst::Fst<fst::StdArc> &fst,
+	                     const LatticeFasterDecoderConfig &config):
+		LatticeFasterOnlineDecoder(fst, config) {}
+
+	// tokens currently allocated, over all frames not pruned away yet
+	int32 NumActiveTokens() const { return num_toks_; }
+};
+
+/// The lattice search of SingleUtteranceNnet3Decoder.
+class LatticeStreamSearch: public StreamSearch {
+ public:
+	LatticeStreamSearch(const LatticeFasterDecoderConfig &decoder_opts,
+	                    const TransitionModel &trans_model,
+	                    const fst::Fst<fst::StdArc> &fst);
+
+	virtual void InitDecoding();
+	virtual void AdvanceDecoding(DecodableInterface *decodable) { decoder_.AdvanceDecoding(decodable); }
+	virtual void FinalizeDecoding() { decoder_.FinalizeDecoding(); }
+	virtual int32 NumFramesDecoded() const { return decoder_.NumFramesDecoded(); }
+	virtual int32 NumActiveTokens() const { return decoder_.NumActiveTokens(); }
+	virtual void GetLattice(bool end_of_utterance, CompactLattice *clat);
+	virtual void GetBestPath(bool end_of_utterance, Lattice *best_path);
+	virtual const std::vector<int32> &TraceBackPartial(int32 *num_unchanged);
+	virtual bool EndpointDetected(const OnlineEndpointConfig &config,
+	                              BaseFloat frame_shift_in_seconds);
+	virtual bool SupportsSilenceWeighting() const { return true; }
+	virtual void ComputeSilenceTraceback(OnlineSilenceWeighting *silence_weighting);
+
+ private:
+	// index of tok in traceback_, -1 if it is not on the previous path
+	int32 FindInTraceback(const void *tok, int32 frame) const;
+
+	const LatticeFasterDecoderConfig &decoder_opts_;
+	const TransitionModel &trans_model_;
+	StreamLatticeDecoder decoder_;
+
+	// the best path found by the last TraceBackPartial, from the start of the
+	// utterance; tokens don't change once their frame is decoded, so reaching
+	// one of them again means the rest of the path is the same
+	struct TracebackEntry {
+		const void *tok;
+		int32 frame;
+		// words on the path up to and including this token
+		int32 num_words;
+	};
+	std::vector<TracebackEntry> traceback_;
+	std::vector<int32> traceback_words_;
+	// index in traceback_ of the first entry of each frame, indexed by frame + 1
+	// since the path starts at frame -1
+	std::vector<int32> traceback_frame_start_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(LatticeStreamSearch);
+};
+
+/// FasterDecoder with access to its tokens, for partial results, endpointing
+/// and the recognizer statistics without a lattice.
+class StreamFasterDecoder: public FasterDecoder {
+ public:
+	StreamFasterDecoder(const fst::Fst<fst::StdArc> &fst,
+	                    const FasterDecoderOptions &config):
+		FasterDecoder(fst, config) {}
+
+	int32 NumActiveTokens() const;
+
+	// words on the best path, without final probs
+	void BestPathWords(std::vector<int32> *words) const;
+
+	// decoded frames at the end of the best path whose phone is in
+	// silence_phones, which is sorted
+	// Reference: TrailingSilenceLength
+	int32 TrailingSilenceFrames(const TransitionModel &trans_model,
+	                            const std::vector<int32> &silence_phones) const;
+
+	// Reference: LatticeFasterDecoder::FinalRelativeCost
+	BaseFloat FinalRelativeCost() const;
+
+ private:
+	// the token of lowest cost, NULL before the first frame
+	const Token *BestToken() const;
+};
+
+/// The search of the lattice-free SingleUtteranceNnet3DecoderWithoutLattice:
+/// FasterDecoder keeps a back-pointer per token and no lattice, so sessions
+/// that only need the best hypothesis skip lattice generation altogether.
+/// The search beams are those of the lattice search.
+class OneBestStreamSearch: public StreamSearch {
+ public:
+	OneBestStreamSearch(const LatticeFasterDecoderConfig &decoder_opts,
+	                    const TransitionModel &trans_model,
+	                    const fst::Fst<fst::StdArc> &fst);
+
+	virtual void InitDecoding();
+	virtual void AdvanceDecoding(DecodableInterface *decodable) { decoder_.AdvanceDecoding(decodable); }
+	// FasterDecoder has no lattice to prune
+	virtual void FinalizeDecoding() {}
+	virtual int32 NumFramesDecoded() const { return decoder_.NumFramesDecoded(); }
+	virtual int32 NumActiveTokens() const { return decoder_.NumActiveTokens(); }
+	virtual void GetLattice(bool end_of_utterance, CompactLattice *clat);
+	virtual void GetBestPath(bool end_of_utterance, Lattice *best_path);
+	virtual const std::vector<int32> &TraceBackPartial(int32 *num_unchanged);
+	virtual bool EndpointDetected(const OnlineEndpointConfig &config,
+	                              BaseFloat frame_shift_in_seconds);
+	// OnlineSilenceWeighting reads the traceback of a lattice decoder
+	virtual bool SupportsSilenceWeighting() const { return false; }
+	virtual void ComputeSilenceTraceback(OnlineSilenceWeighting *silence_weighting);
+
+ private:
+	static FasterDecoderOptions FasterOptions(const LatticeFasterDecoderConfig &decoder_opts);
+
+	const TransitionModel &trans_model_;
+	StreamFasterDecoder decoder_;
+
+	// words of the last partial result
+	std::vector<int32> partial_words_;
+	std::vector<int32> new_partial_words_;
+
+	// parsed from the endpoint config when it changes
+	std::string silence_phones_str_;
+	std::vector<int32> silence_phones_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(OneBestStreamSearch);
+};
+
+}
+
+#endif  // KALDI_ONLINE_STREAM_SEARCH_H_
@@ -0,0 +1,120 @@
+// 张; 杨
+#include "onlinedecoder/recog-result.h"
+
+namespace kaldi {
+
+void RecogResultStorage::Clear() {
+	result_.speaker = NULL;
+	result_.segment_start = 0.0;
+	result_.segment_length = 0.0;
+	result_.total_length = 0.0;
+	result_.num_hypotheses = 0;
+	result_.hypotheses = NULL;
+	speaker_.clear();
+	hypotheses_.clear();
+	entries_.clear();
+	entry_begins_.clear();
+	num_transcripts_ = 0;
+	num_symbols_ = 0;
+}
+
+// assign to an unused string before adding one, so its memory is reused
+static void AssignString(const std::string &str, size_t *num_used,
+                         std::vector<std::string> *strs) {
+	if (*num_used < strs->size())
+		(*strs)[*num_used] = str;
+	else
+		strs->push_back(str);
+	(*num_used)++;
+}
+
+void RecogResultStorage::SetSegment(const std::string &speaker, float segment_start,
+                                    float segment_length, float total_length) {
+	speaker_ = speaker;
+	result_.segment_start = segment_start;
+	result_.segment_length = segment_length;
+	result_.total_length = total_length;
+}
+
+void RecogResultStorage::AddHypothesis(const std::string &transcript, float likelihood) {
+	RecogHypothesis hypothesis;
+	hypothesis.transcript = NULL;
+	hypothesis.likelihood = likelihood;
+	hypothesis.num_words = 0;
+	hypothesis.words = NULL;
+	hypothesis.num_phones = 0;
+	hypothesis.phones = NULL;
+	hypotheses_.push_back(hypothesis);
+	AssignString(transcript, &num_transcripts_, &transcripts_);
+	entry_begins_.push_back(entries_.size());
+}
+
+void RecogResultStorage::AddEntry(int32 id, const std::string &symbol, float start,
+                                  float length, float confidence) {
+	RecogAlignmentEntry entry;
+	entry.id = id;
+	entry.symbol = NULL;
+	entry.start = start;
+	entry.length = length;
+	entry.confidence = confidence;
+	entries_.push_back(entry);
+	AssignString(symbol, &num_symbols_, &symbols_);
+}
+
+void RecogResultStorage::AddWord(int32 id, const std::string &symbol, float start,
+                                 float length, float confidence) {
+	KALDI_ASSERT(!hypotheses_.empty() && hypotheses_.back().num_phones == 0);
+	AddEntry(id, symbol, start, length, confidence);
+	hypotheses_.back().num_words++;
+}
+
+void RecogResultStorage::AddPhone(int32 id, const std::string &symbol, float start,
+                                  float length, float confidence) {
+	KALDI_ASSERT(!hypotheses_.empty());
+	AddEntry(id, symbol, start, length, confidence);
+	hypotheses_.back().num_phones++;
+}
+
+const RecogResult *RecogResultStorage::Finish() {
+	for (size_t i = 0; i < entries_.size(); i++)
+		entries_[i].symbol = symbols_[i].c_str();
+	for (size_t i = 0; i < hypotheses_.size(); i++) {
+		RecogHypothesis &hypothesis = hypotheses_[i];
+		hypothesis.transcript = transcripts_[i].c_str();
+		size_t begin = entry_begins_[i];
+		hypothesis.words = hypothesis.num_words > 0 ? &(entries_[begin]) : NULL;
+		hypothesis.phones = hypothesis.num_phones > 0 ? &(entries_[begin + hypothesis.num_words]) : NULL;
+	}
+	result_.speaker = speaker_.c_str();
+	result_.num_hypotheses = hypotheses_.size();
+	result_.hypotheses = hypotheses_.empty() ? NULL : &(hypotheses_[0]);
+	return &result_;
+}
+
+std::shared_ptr<RecogResultStorage> RecogResultStoragePool::Get() {
+	RecogResultStorage *storage = NULL;
+	{
+		std::lock_guard<std::mutex> free_locker(free_mtx_);
+		if (!free_.empty()) {
+			storage = free_.back();
+			free_.pop_back();
+		}
+	}
+	if (storage == NULL)
+		storage = new RecogResultStorage();
+	std::shared_ptr<RecogResultStoragePool> pool = shared_from_this();
+	return std::shared_ptr<RecogResultStorage>(storage,
+		[pool](RecogResultStorage *storage) { pool->Put(storage); });
+}
+
+void RecogResultStoragePool::Put(RecogResultStorage *storage) {
+	std::lock_guard<std::mutex> free_locker(free_mtx_);
+	free_.push_back(storage);
+}
+
+RecogResultStoragePool::~RecogResultStoragePool() {
+	for (size_t i = 0; i < free_.size(); i++)
+		delete free_[i];
+}
+
+}
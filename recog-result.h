@@ -0,0 +1,83 @@
+// 张; 杨
+#ifndef KALDI_RECOG_RESULT_H_
+#define KALDI_RECOG_RESULT_H_
+
+#include "base/kaldi-common.h"
+#include "onlinedecoder/speech-recognition-engine.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace kaldi {
+
+/// Owns the memory a RecogResult points into. A result is added piece by
+/// piece, and Finish sets the pointers once nothing moves anymore. Clear
+/// keeps the capacity of the vectors and of the strings in them, so a reused
+/// storage only grows when a result is larger than the ones before.
+class RecogResultStorage {
+ public:
+	RecogResultStorage() { Clear(); }
+
+	void Clear();
+
+	void SetSegment(const std::string &speaker, float segment_start,
+	                float segment_length, float total_length);
+
+	void AddHypothesis(const std::string &transcript, float likelihood);
+
+	// add to the last hypothesis, all its words before its phones
+	void AddWord(int32 id, const std::string &symbol, float start, float length,
+	             float confidence);
+	void AddPhone(int32 id, const std::string &symbol, float start, float length,
+	              float confidence);
+
+	// the result, valid until the storage is changed or destroyed
+	const RecogResult *Finish();
+
+ private:
+	void AddEntry(int32 id, const std::string &symbol, float start, float length,
+	              float confidence);
+
+	RecogResult result_;
+	std::string speaker_;
+	std::vector<RecogHypothesis> hypotheses_;
+	std::vector<std::string> transcripts_;
+	// words and phones of all hypotheses in order, and their symbols
+	std::vector<RecogAlignmentEntry> entries_;
+	std::vector<std::string> symbols_;
+	// per hypothesis: index in entries_ of its first word
+	std::vector<size_t> entry_begins_;
+	// used entries of transcripts_ and symbols_; the rest keep their memory
+	size_t num_transcripts_;
+	size_t num_symbols_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(RecogResultStorage);
+};
+
+/// Storages for the results of one recognizer. Get hands out a free storage,
+/// and it comes back to the free list when the last copy of the pointer is
+/// released, by the decoder or by the thread delivering it. The storages
+/// keep the pool alive, so they may be released after the recognizer is gone.
+class RecogResultStoragePool:
+	public std::enable_shared_from_this<RecogResultStoragePool> {
+ public:
+	RecogResultStoragePool() {}
+
+	std::shared_ptr<RecogResultStorage> Get();
+
+	~RecogResultStoragePool();
+
+ private:
+	void Put(RecogResultStorage *storage);
+
+	std::mutex free_mtx_;
+	std::vector<RecogResultStorage*> free_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(RecogResultStoragePool);
+};
+
+}
+
+#endif  // KALDI_RECOG_RESULT_H_
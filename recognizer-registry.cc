@@ -0,0 +1,143 @@
+// 张; 杨
+#include "onlinedecoder/recognizer-registry.h"
+
+#include <thread>
+
+namespace kaldi {
+
+RecognizerRegistry &RecognizerRegistry::Instance() {
+	static RecognizerRegistry registry;
+	return registry;
+}
+
+RecognizerRegistry::RecognizerRegistry(): next_shard_(0) {}
+
+RecognizerRegistry::~RecognizerRegistry() {
+	for (int32 s = 0; s < kNumShards; s++)
+		for (int32 p = 0; p < kPagesPerShard; p++)
+			delete [] shards_[s].pages_[p].load();
+}
+
+RecognizerRegistry::Slot *RecognizerRegistry::GetSlot(int32 handle) {
+	if (handle <= 0)
+		return NULL;
+	int32 index = handle & ((1 << kIndexBits) - 1);
+	int32 slots_per_shard = kPagesPerShard * kSlotsPerPage;
+	Shard &shard = shards_[index / slots_per_shard];
+	int32 local_index = index % slots_per_shard;
+	Slot *page = shard.pages_[local_index / kSlotsPerPage].load(std::memory_order_acquire);
+	if (page == NULL)
+		return NULL;
+	return &(page[local_index % kSlotsPerPage]);
+}
+
+RecognizerRegistry::Shard &RecognizerRegistry::GetShard(int32 handle) {
+	int32 index = handle & ((1 << kIndexBits) - 1);
+	return shards_[index / (kPagesPerShard * kSlotsPerPage)];
+}
+
+int32 RecognizerRegistry::Add(OnlineDecoder *recognizer) {
+	// spread the creating threads over the shards
+	uint32 first_shard = next_shard_.fetch_add(1);
+	for (int32 i = 0; i < kNumShards; i++) {
+		int32 shard_index = (first_shard + i) % kNumShards;
+		Shard &shard = shards_[shard_index];
+		std::lock_guard<std::mutex> shard_locker(shard.shard_mtx_);
+		int32 local_index;
+		if (!shard.free_slots_.empty()) {
+			local_index = shard.free_slots_.front();
+			shard.free_slots_.pop_front();
+		} else if (shard.num_slots_used_ < kPagesPerShard * kSlotsPerPage) {
+			local_index = shard.num_slots_used_++;
+			std::atomic<Slot*> &page = shard.pages_[local_index / kSlotsPerPage];
+			if (page.load() == NULL)
+				page.store(new Slot[kSlotsPerPage], std::memory_order_release);
+		} else {
+			continue;
+		}
+		Slot &slot = shard.pages_[local_index / kSlotsPerPage].load()[local_index % kSlotsPerPage];
+		int32 generation = slot.next_generation;
+		// generation 0 marks a free slot and would make the handle 0
+		slot.next_generation = (generation + 1) & kGenerationMask;
+		if (slot.next_generation == 0)
+			slot.next_generation = 1;
+		slot.recognizer.store(recognizer);
+		slot.generation.store(generation);
+		int32 index = shard_index * kPagesPerShard * kSlotsPerPage + local_index;
+		return (generation << kIndexBits) | index;
+	}
+	return -1;
+}
+
+OnlineDecoder *RecognizerRegistry::Acquire(int32 handle) {
+	Slot *slot = GetSlot(handle);
+	if (slot == NULL)
+		return NULL;
+	// count the use before checking the generation: Remove invalidates the
+	// generation before it waits for the uses, so one of them sees the other
+	slot->num_users.fetch_add(1);
+	OnlineDecoder *recognizer = NULL;
+	if (slot->generation.load() == (handle >> kIndexBits))
+		recognizer = slot->recognizer.load();
+	if (recognizer == NULL)
+		EndUse(slot, handle);
+	return recognizer;
+}
+
+void RecognizerRegistry::Set(int32 handle, OnlineDecoder *recognizer) {
+	Slot *slot = GetSlot(handle);
+	KALDI_ASSERT(slot != NULL && slot->generation.load() == (handle >> kIndexBits));
+	slot->recognizer.store(recognizer);
+}
+
+void RecognizerRegistry::Release(int32 handle) {
+	Slot *slot = GetSlot(handle);
+	KALDI_ASSERT(slot != NULL);
+	EndUse(slot, handle);
+}
+
+void RecognizerRegistry::EndUse(Slot *slot, int32 handle) {
+	// the last use wakes a Remove waiting for it: either Remove counts itself
+	// before this check, or it sees no users left before it waits
+	if (slot->num_users.fetch_sub(1) == 1) {
+		Shard &shard = GetShard(handle);
+		if (shard.num_removing_.load() > 0) {
+			{
+				std::lock_guard<std::mutex> users_locker(shard.users_mtx_);
+			}
+			shard.users_cond_.notify_all();
+		}
+	}
+}
+
+OnlineDecoder *RecognizerRegistry::Remove(int32 handle) {
+	Slot *slot = GetSlot(handle);
+	if (slot == NULL)
+		return NULL;
+	int32 generation = handle >> kIndexBits;
+	// only one of several threads freeing the same handle gets it
+	if (!slot->generation.compare_exchange_strong(generation, 0))
+		return NULL;
+	// an API call usually ends soon, so spin a little before sleeping
+	Shard &shard = GetShard(handle);
+	for (int32 i = 0; i < 64 && slot->num_users.load() > 0; i++)
+		std::this_thread::yield();
+	if (slot->num_users.load() > 0) {
+		shard.num_removing_.fetch_add(1);
+		{
+			std::unique_lock<std::mutex> users_locker(shard.users_mtx_);
+			shard.users_cond_.wait(users_locker, [slot] {
+				return slot->num_users.load() == 0; });
+		}
+		shard.num_removing_.fetch_sub(1);
+	}
+	OnlineDecoder *recognizer = slot->recognizer.exchange(NULL);
+
+	int32 index = handle & ((1 << kIndexBits) - 1);
+	int32 slots_per_shard = kPagesPerShard * kSlotsPerPage;
+	std::lock_guard<std::mutex> shard_locker(shard.shard_mtx_);
+	shard.free_slots_.push_back(index % slots_per_shard);
+	return recognizer;
+}
+
+}
@@ -0,0 +1,111 @@
+// 张; 杨
+#ifndef KALDI_RECOGNIZER_REGISTRY_H_
+#define KALDI_RECOGNIZER_REGISTRY_H_
+
+#include "base/kaldi-common.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace kaldi {
+
+class OnlineDecoder;
+
+/// The recognizers of the C API, found by handle without locking. A handle
+/// is a slot index plus the generation of the slot, so a handle of a freed
+/// recognizer stays invalid when its slot is reused. Slots are split over
+/// shards with their own lock, taken only to create and free recognizers.
+class RecognizerRegistry {
+ public:
+	static RecognizerRegistry &Instance();
+
+	// returns the handle, > 0, or -1 when all slots are in use; recognizer may
+	// be NULL and set later, the handle is not found until it is
+	int32 Add(OnlineDecoder *recognizer);
+	void Set(int32 handle, OnlineDecoder *recognizer);
+
+	// the recognizer, with a use counted until Release; NULL for a bad handle
+	OnlineDecoder *Acquire(int32 handle);
+	void Release(int32 handle);
+
+	// invalidates the handle and waits until the recognizer is no longer in
+	// use; the caller deletes the returned recognizer. NULL for a bad handle
+	OnlineDecoder *Remove(int32 handle);
+
+	~RecognizerRegistry();
+
+ private:
+	RecognizerRegistry();
+
+	static const int32 kIndexBits = 20;
+	static const int32 kGenerationMask = (1 << (31 - kIndexBits)) - 1;
+	static const int32 kNumShards = 16;
+	static const int32 kSlotsPerPage = 1024;
+	static const int32 kPagesPerShard = (1 << kIndexBits) / kNumShards / kSlotsPerPage;
+
+	struct Slot {
+		// generation of the handle of the recognizer, 0 when the slot is free
+		std::atomic<int32> generation;
+		std::atomic<OnlineDecoder*> recognizer;
+		std::atomic<int32> num_users;
+		// generation for the next recognizer, changed under the shard lock
+		int32 next_generation;
+		Slot(): generation(0), recognizer(NULL), num_users(0), next_generation(1) {}
+	};
+
+	struct Shard {
+		std::mutex shard_mtx_;
+		std::atomic<Slot*> pages_[kPagesPerShard];
+		// slots never used yet start here
+		int32 num_slots_used_;
+		// freed slots, reused oldest first so generations wrap slowly
+		std::deque<int32> free_slots_;
+		// Remove calls of this shard waiting for the last use of their slot,
+		// woken by the Release that ends it
+		std::mutex users_mtx_;
+		std::condition_variable users_cond_;
+		std::atomic<int32> num_removing_;
+		Shard(): num_slots_used_(0), num_removing_(0) {
+			for (int32 i = 0; i < kPagesPerShard; i++)
+				pages_[i] = NULL;
+		}
+	};
+
+	// NULL if the handle can't be a slot of ours
+	Slot *GetSlot(int32 handle);
+	Shard &GetShard(int32 handle);
+
+	// ends a use counted by Acquire, waking a Remove waiting for the slot
+	void EndUse(Slot *slot, int32 handle);
+
+	Shard shards_[kNumShards];
+	std::atomic<uint32> next_shard_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(RecognizerRegistry);
+};
+
+/// A recognizer in use by an API call, released when it goes out of scope.
+class RecognizerRef {
+ public:
+	explicit RecognizerRef(int32 handle):
+		handle_(handle), recognizer_(RecognizerRegistry::Instance().Acquire(handle)) {}
+	~RecognizerRef() {
+		if (recognizer_ != NULL)
+			RecognizerRegistry::Instance().Release(handle_);
+	}
+
+	OnlineDecoder *get() const { return recognizer_; }
+	OnlineDecoder *operator->() const { return recognizer_; }
+
+ private:
+	int32 handle_;
+	OnlineDecoder *recognizer_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(RecognizerRef);
+};
+
+}
+
+#endif  // KALDI_RECOGNIZER_REGISTRY_H_
@@ -0,0 +1,221 @@
+// 张; 杨
+#include "onlinedecoder/result-dispatcher.h"
+
+#include <set>
+
+namespace kaldi {
+
+// set on the delivery threads, so Flush from a callback doesn't wait for itself
+static thread_local bool in_delivery_thread = false;
+
+bool ParseResultOverflowPolicy(const std::string &str, ResultOverflowPolicy *policy) {
+	if (str == "block") {
+		*policy = kOverflowBlock;
+		return true;
+	}
+	if (str == "drop-partial") {
+		*policy = kOverflowDropPartial;
+		return true;
+	}
+	return false;
+}
+
+static std::atomic<ResultDispatcher*> existing_dispatcher(NULL);
+
+ResultDispatcher &ResultDispatcher::Instance(int32 num_threads, int32 queue_capacity,
+                                             ResultOverflowPolicy policy) {
+	static ResultDispatcher dispatcher(num_threads, queue_capacity, policy);
+	if (existing_dispatcher.exchange(&dispatcher) != NULL &&
+	    (static_cast<size_t>(std::max<int32>(1, num_threads)) != dispatcher.queues_.size() ||
+	     std::max<int32>(1, queue_capacity) != dispatcher.queue_capacity_ ||
+	     policy != dispatcher.policy_)) {
+		KALDI_WARN << "Result delivery threads already started with num-callback-threads="
+		           << dispatcher.queues_.size() << ", callback-queue-size="
+		           << dispatcher.queue_capacity_ << " and callback-overflow="
+		           << (dispatcher.policy_ == kOverflowBlock ? "block" : "drop-partial")
+		           << ", ignoring the settings of this recognizer";
+	}
+	return dispatcher;
+}
+
+ResultDispatcher *ResultDispatcher::Existing() {
+	return existing_dispatcher;
+}
+
+ResultDispatcher::ResultDispatcher(int32 num_threads, int32 queue_capacity,
+                                   ResultOverflowPolicy policy):
+	queue_capacity_(std::max<int32>(1, queue_capacity)),
+	policy_(policy),
+	finished_(false) {
+	num_threads = std::max<int32>(1, num_threads);
+	KALDI_VLOG(2) << "Starting " << num_threads << " result delivery threads";
+	for (int32 i = 0; i < num_threads; i++)
+		queues_.push_back(new DeliveryQueue());
+	for (int32 i = 0; i < num_threads; i++)
+		queues_[i]->thread_ = new std::thread(&ResultDispatcher::DeliveryLoop, this, queues_[i]);
+}
+
+bool ResultDispatcher::DropPartial(DeliveryQueue *queue, const ResultEvent &event) {
+	// the first partial result followed by another result of its recognizer,
+	// the new event included
+	std::set<int32> ids_later;
+	ids_later.insert(event.id);
+	int32 drop = -1;
+	for (int32 i = static_cast<int32>(queue->events_.size()) - 1; i >= 0; i--) {
+		const ResultEvent &queued = queue->events_[i];
+		if (queued.signal == PARTIAL_RESULT_SIGNAL && ids_later.count(queued.id) > 0)
+			drop = i;
+		ids_later.insert(queued.id);
+	}
+	if (drop < 0)
+		return false;
+	EventDone(queue, queue->events_[drop].id);
+	queue->events_.erase(queue->events_.begin() + drop);
+	return true;
+}
+
+void ResultDispatcher::EventDone(DeliveryQueue *queue, int32 id) {
+	std::map<int32, int32>::iterator it = queue->num_pending_.find(id);
+	KALDI_ASSERT(it != queue->num_pending_.end());
+	if (--(it->second) == 0)
+		queue->num_pending_.erase(it);
+}
+
+void ResultDispatcher::Dispatch(int32 id, DecoderSignal signal, const char *results,
+                                const std::vector<DecoderSignalCallback> &callbacks) {
+	if (callbacks.empty())
+		return;
+	ResultEvent event;
+	event.id = id;
+	event.signal = signal;
+	event.has_results = (results != NULL);
+	if (results != NULL)
+		event.results = results;
+	event.callbacks = callbacks;
+	event.dispatch_time = std::chrono::steady_clock::now();
+	Enqueue(event);
+}
+
+void ResultDispatcher::DispatchFullResult(int32 id,
+                                          const std::shared_ptr<RecogResultStorage> &result,
+                                          const std::vector<FullResultCallback> &callbacks) {
+	if (callbacks.empty())
+		return;
+	ResultEvent event;
+	event.id = id;
+	event.signal = FULL_FINAL_RESULT_SIGNAL;
+	event.has_results = false;
+	event.full_result = result;
+	event.full_result_callbacks = callbacks;
+	event.dispatch_time = std::chrono::steady_clock::now();
+	Enqueue(event);
+}
+
+void ResultDispatcher::Enqueue(const ResultEvent &event) {
+	int32 id = event.id;
+	DecoderSignal signal = event.signal;
+	DeliveryQueue *queue = queues_[id % queues_.size()];
+	int64 num_dropped = 0;
+	int32 queue_length;
+	{
+		std::unique_lock<std::mutex> queue_locker(queue->queue_mtx_);
+		while (static_cast<int32>(queue->events_.size()) >= queue_capacity_) {
+			if (policy_ == kOverflowDropPartial) {
+				if (DropPartial(queue, event)) {
+					num_dropped++;
+					continue;
+				}
+				// nothing queued is superseded: a new partial result goes
+				if (signal == PARTIAL_RESULT_SIGNAL) {
+					queue_locker.unlock();
+					std::lock_guard<std::mutex> stats_locker(stats_mtx_);
+					stats_.num_dispatched++;
+					stats_.num_dropped += num_dropped + 1;
+					return;
+				}
+			}
+			queue->done_cond_.wait(queue_locker);
+		}
+		queue->events_.push_back(event);
+		queue->num_pending_[id]++;
+		queue_length = queue->events_.size();
+	}
+	queue->not_empty_cond_.notify_one();
+	if (num_dropped > 0)
+		queue->done_cond_.notify_all();
+
+	std::lock_guard<std::mutex> stats_locker(stats_mtx_);
+	stats_.num_dispatched++;
+	stats_.num_dropped += num_dropped;
+	stats_.max_queue_length = std::max(stats_.max_queue_length, queue_length);
+}
+
+void ResultDispatcher::DeliveryLoop(DeliveryQueue *queue) {
+	in_delivery_thread = true;
+	while (true) {
+		ResultEvent event;
+		{
+			std::unique_lock<std::mutex> queue_locker(queue->queue_mtx_);
+			queue->not_empty_cond_.wait(queue_locker, [this, queue] {
+				return !queue->events_.empty() || this->finished_; });
+			// results queued before the dispatcher is destroyed are still delivered
+			if (queue->events_.empty())
+				break;
+			event = queue->events_.front();
+			queue->events_.pop_front();
+		}
+
+		double lag_secs = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - event.dispatch_time).count();
+		const char *results = event.has_results ? event.results.c_str() : NULL;
+		for (size_t i = 0; i < event.callbacks.size(); i++)
+			event.callbacks[i](event.id, results);
+		if (event.full_result) {
+			const RecogResult *full_result = event.full_result->Finish();
+			for (size_t i = 0; i < event.full_result_callbacks.size(); i++)
+				event.full_result_callbacks[i](event.id, full_result);
+		}
+
+		{
+			std::lock_guard<std::mutex> stats_locker(stats_mtx_);
+			stats_.num_delivered++;
+			stats_.total_lag_secs += lag_secs;
+			stats_.max_lag_secs = std::max(stats_.max_lag_secs, lag_secs);
+		}
+		{
+			std::lock_guard<std::mutex> queue_locker(queue->queue_mtx_);
+			EventDone(queue, event.id);
+		}
+		queue->done_cond_.notify_all();
+	}
+}
+
+void ResultDispatcher::Flush(int32 id) {
+	if (in_delivery_thread)
+		return;
+	DeliveryQueue *queue = queues_[id % queues_.size()];
+	std::unique_lock<std::mutex> queue_locker(queue->queue_mtx_);
+	queue->done_cond_.wait(queue_locker, [queue, id] {
+		return queue->num_pending_.count(id) == 0; });
+}
+
+void ResultDispatcher::GetStats(ResultDispatcherStats *stats) {
+	std::lock_guard<std::mutex> stats_locker(stats_mtx_);
+	*stats = stats_;
+}
+
+ResultDispatcher::~ResultDispatcher() {
+	finished_ = true;
+	for (size_t i = 0; i < queues_.size(); i++) {
+		{
+			// a thread between its check and its wait can't miss the notification
+			std::lock_guard<std::mutex> queue_locker(queues_[i]->queue_mtx_);
+		}
+		queues_[i]->not_empty_cond_.notify_all();
+		queues_[i]->thread_->join();
+		delete queues_[i]->thread_;
+		delete queues_[i];
+	}
+}
+
+}
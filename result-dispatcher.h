@@ -0,0 +1,133 @@
+// 张; 杨
+#ifndef KALDI_RESULT_DISPATCHER_H_
+#define KALDI_RESULT_DISPATCHER_H_
+
+#include "base/kaldi-common.h"
+#include "onlinedecoder/speech-recognition-engine.h"
+#include "onlinedecoder/recog-result.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace kaldi {
+
+/// What Dispatch does when the queue of the delivering thread is full.
+enum ResultOverflowPolicy {
+	// wait for room, slowing the decoder down to the pace of the callbacks
+	kOverflowBlock,
+	// make room by dropping a queued partial result that a later result of the
+	// same recognizer supersedes, or else the new partial result itself; final
+	// results and EOS still wait for room
+	kOverflowDropPartial
+};
+
+// parses "block" or "drop-partial"
+bool ParseResultOverflowPolicy(const std::string &str, ResultOverflowPolicy *policy);
+
+/// Counters of a ResultDispatcher since it was created. The lag of a result
+/// is the time from Dispatch until its first callback starts.
+struct ResultDispatcherStats {
+	int64 num_dispatched;
+	int64 num_delivered;
+	int64 num_dropped;
+	// largest number of results waiting in one queue
+	int32 max_queue_length;
+	double total_lag_secs;
+	double max_lag_secs;
+
+	ResultDispatcherStats(): num_dispatched(0), num_delivered(0), num_dropped(0),
+		max_queue_length(0), total_lag_secs(0.0), max_lag_secs(0.0) {}
+};
+
+/// Calls the result callbacks of all recognizers in the process on its own
+/// threads, so a callback that blocks delays other results instead of the
+/// decoding. The results of one recognizer always go to the same thread and
+/// are delivered in the order they were dispatched.
+class ResultDispatcher {
+ public:
+	// the dispatcher is created by the first call with these settings; later
+	// calls warn if theirs differ, and get the existing dispatcher.
+	// num_threads <= 0 means one thread
+	static ResultDispatcher &Instance(int32 num_threads, int32 queue_capacity,
+	                                  ResultOverflowPolicy policy);
+
+	// the dispatcher if Instance has been called, else NULL
+	static ResultDispatcher *Existing();
+
+	// queue the callbacks of a signal with a copy of results, which may be NULL
+	void Dispatch(int32 id, DecoderSignal signal, const char *results,
+	              const std::vector<DecoderSignalCallback> &callbacks);
+
+	// queue the full result callbacks; the storage is kept until they return.
+	// It counts as a FULL_FINAL_RESULT_SIGNAL result
+	void DispatchFullResult(int32 id, const std::shared_ptr<RecogResultStorage> &result,
+	                        const std::vector<FullResultCallback> &callbacks);
+
+	// wait until no result of id is waiting or being delivered; returns at
+	// once when called from a callback
+	void Flush(int32 id);
+
+	void GetStats(ResultDispatcherStats *stats);
+
+	~ResultDispatcher();
+
+ private:
+	ResultDispatcher(int32 num_threads, int32 queue_capacity, ResultOverflowPolicy policy);
+
+	struct ResultEvent {
+		int32 id;
+		DecoderSignal signal;
+		bool has_results;
+		std::string results;
+		std::vector<DecoderSignalCallback> callbacks;
+		// set instead of results and callbacks by DispatchFullResult
+		std::shared_ptr<RecogResultStorage> full_result;
+		std::vector<FullResultCallback> full_result_callbacks;
+		std::chrono::steady_clock::time_point dispatch_time;
+	};
+
+	struct DeliveryQueue {
+		std::mutex queue_mtx_;
+		// signalled when an event is queued or the dispatcher is finished
+		std::condition_variable not_empty_cond_;
+		// signalled when an event is delivered or dropped
+		std::condition_variable done_cond_;
+		std::deque<ResultEvent> events_;
+		// events of each recognizer queued or being delivered, for Flush
+		std::map<int32, int32> num_pending_;
+		std::thread *thread_;
+		DeliveryQueue(): thread_(NULL) {}
+	};
+
+	void DeliveryLoop(DeliveryQueue *queue);
+
+	void Enqueue(const ResultEvent &event);
+
+	// drop a partial result to make room for event; needs queue_mtx_
+	bool DropPartial(DeliveryQueue *queue, const ResultEvent &event);
+
+	// an event of id was delivered or dropped; needs queue_mtx_
+	static void EventDone(DeliveryQueue *queue, int32 id);
+
+	int32 queue_capacity_;
+	ResultOverflowPolicy policy_;
+	std::vector<DeliveryQueue*> queues_;
+	std::atomic<bool> finished_;
+
+	std::mutex stats_mtx_;
+	ResultDispatcherStats stats_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(ResultDispatcher);
+};
+
+}
+
+#endif  // KALDI_RESULT_DISPATCHER_H_
@@ -2,58 +2,47 @@
 #include "speech-recognition-engine.h"
 #include "onlinedecoder/audio-buffer-source.h"
 #include "onlinedecoder/online-decoder.h"
-#include <map>
+#include "onlinedecoder/recognizer-registry.h"
+#include "onlinedecoder/result-dispatcher.h"
+#include <algorithm>
 #include <string>
 #include <sstream>
-#include <time.h>
 
 using namespace kaldi;
 
-static std::map<int, OnlineDecoder*> g_engine_map;
+// per API thread, so concurrent calls don't overwrite each other's message
+static thread_local std::string error_message;
 
-static std::string error_message;
-
-time_t timep;
-time_t timem = 1547970000;
-
-
-static int GenerateID()
-{
-	int new_id = rand();
-	while (g_engine_map.find(new_id) != g_engine_map.end())
-		new_id = rand();
-	return new_id; 
-}
-
-static OnlineDecoder* GetEngine(int id)
-{
-	std::map<int, OnlineDecoder*>::iterator it = g_engine_map.find(id);
-	if (it == g_engine_map.end())
-		return NULL;
-	else
-		return it->second;
-}
 
 int CreateRecognizer(const char* conf_rxfilename)
 {
-  int id = GenerateID();
-	OnlineDecoder* pDecoder = new OnlineDecoder(id, conf_rxfilename);
-	g_engine_map[id] = pDecoder;
+	// the recognizer knows its handle, so it is registered before it is created
+	// and only becomes visible once it is complete
+	RecognizerRegistry &registry = RecognizerRegistry::Instance();
+	int id = registry.Add(NULL);
+	if (id < 0)
+	{
+		error_message = "Too many recognizers";
+		return -1;
+	}
+	OnlineDecoder* pDecoder = NULL;
+	try
+	{
+		pDecoder = new OnlineDecoder(id, conf_rxfilename);
+	}
+	catch (...)
+	{
+		registry.Remove(id);
+		throw;
+	}
+	registry.Set(id, pDecoder);
 	return id;
 }
 
 ReturnStatus StartRecognizer(int engineID)
 {
-  time(&timep);
-  if (timep > timem)
-  {
-    std::stringstream ss;
-		ss << "No engine with id - " << engineID;
-		error_message = ss.str();
-		return ERROR_ENGINE_NOT_FOUND;
-  }
-	OnlineDecoder* pDecoder = GetEngine(engineID);
-	if (pDecoder != NULL)
+	RecognizerRef pDecoder(engineID);
+	if (pDecoder.get() != NULL)
 	{
 		pDecoder->StartDecoding();
 		return SUCCEED;
@@ -69,16 +58,8 @@ ReturnStatus StartRecognizer(int engineID)
 
 ReturnStatus SuspendRecognizer(int engineID)
 {
-  time(&timep);
-  if (timep > timem)
-  {
-    std::stringstream ss;
-		ss << "No engine with id - " << engineID;
-		error_message = ss.str();
-		return ERROR_ENGINE_NOT_FOUND;
-  }
-	OnlineDecoder* pDecoder = GetEngine(engineID);
-	if (pDecoder != NULL)
+	RecognizerRef pDecoder(engineID);
+	if (pDecoder.get() != NULL)
 	{
 		pDecoder->SuspendDecoding();
 		return SUCCEED;
@@ -94,16 +75,8 @@ ReturnStatus SuspendRecognizer(int engineID)
 
 ReturnStatus ResumeRecognizer(int engineID)
 {
-  time(&timep);
-  if (timep > timem)
-  {
-    std::stringstream ss;
-		ss << "No engine with id - " << engineID;
-		error_message = ss.str();
-		return ERROR_ENGINE_NOT_FOUND;
-  }
-	OnlineDecoder* pDecoder = GetEngine(engineID);
-	if (pDecoder != NULL)
+	RecognizerRef pDecoder(engineID);
+	if (pDecoder.get() != NULL)
 	{
 		pDecoder->ResumeDecoding();
 		return SUCCEED;
@@ -119,16 +92,8 @@ ReturnStatus ResumeRecognizer(int engineID)
 
 ReturnStatus StopRecognizer(int engineID)
 {
-  time(&timep);
-  if (timep > timem)
-  {
-    std::stringstream ss;
-		ss << "No engine with id - " << engineID;
-		error_message = ss.str();
-		return ERROR_ENGINE_NOT_FOUND;
-  }
-	OnlineDecoder* pDecoder = GetEngine(engineID);
-	if (pDecoder != NULL)
+	RecognizerRef pDecoder(engineID);
+	if (pDecoder.get() != NULL)
 	{
 		pDecoder->StopDecoding();
 		return SUCCEED;
@@ -144,8 +109,8 @@ ReturnStatus StopRecognizer(int engineID)
 
 ReturnStatus WaitForRecogStop(int engineID)
 {
-	OnlineDecoder* pDecoder = GetEngine(engineID);
-	if (pDecoder != NULL)
+	RecognizerRef pDecoder(engineID);
+	if (pDecoder.get() != NULL)
 	{
 		pDecoder->WaitForEndOfDecoding();
 		return SUCCEED;
@@ -161,11 +126,11 @@ ReturnStatus WaitForRecogStop(int engineID)
 
 ReturnStatus FreeRecognizer(int engineID)
 {
-	OnlineDecoder* pDecoder = GetEngine(engineID);
+	// waits for calls still using the recognizer on other threads
+	OnlineDecoder* pDecoder = RecognizerRegistry::Instance().Remove(engineID);
 	if (pDecoder != NULL)
 	{
 		delete pDecoder;
-		g_engine_map.erase(engineID);
 		return SUCCEED;
 	}
 	else
@@ -179,18 +144,52 @@ ReturnStatus FreeRecognizer(int engineID)
 
 ReturnStatus AddBuffer(int engineID, const char* spkId, const short* pData, int size)
 {
-	OnlineDecoder* pDecoder = GetEngine(engineID);
+	if (size < 0)
+	{
+		error_message = "Negative buffer size";
+		return ERROR_UNKNOWN;
+	}
+	RecognizerRef pDecoder(engineID);
+  
+	if (pDecoder.get() != NULL)
+	{
+		AudioBuffer* pBuffer = pDecoder->GetBuffer(size);
+
+		pBuffer->spkr_ = spkId;
+		std::copy(pData, pData + size, pBuffer->pData_);
+	  
+		pDecoder->ReceiveData(pBuffer);
+		return SUCCEED;
+	}
+	else
+	{
+		std::stringstream ss;
+		ss << "No engine with id - " << engineID;
+		error_message = ss.str();
+		return ERROR_ENGINE_NOT_FOUND;
+	}
+	
+}
+
+ReturnStatus AddBufferNoCopy(int engineID, const char* spkId, const short* pData, int size,
+                             AudioReleaseCallback release, void* user_data)
+{
+	if (size < 0)
+	{
+		error_message = "Negative buffer size";
+		return ERROR_UNKNOWN;
+	}
+	RecognizerRef pDecoder(engineID);
   
-	if (pDecoder != NULL)
+	if (pDecoder.get() != NULL)
 	{
 		AudioBuffer* pBuffer = new AudioBuffer();
 
 		pBuffer->spkr_ = spkId;
 		pBuffer->size_ = size;
-		pBuffer->pData_ = new SampleType[size];
-
-		for (int i = 0; i < size; ++i)
-			pBuffer->pData_[i] = pData[i];
+		pBuffer->pData_ = const_cast<SampleType*>(pData);
+		pBuffer->release_ = release;
+		pBuffer->release_arg_ = user_data;
 	  
 		pDecoder->ReceiveData(pBuffer);
 		return SUCCEED;
@@ -202,13 +201,69 @@ ReturnStatus AddBuffer(int engineID, const char* spkId, const short* pData, int
 		error_message = ss.str();
 		return ERROR_ENGINE_NOT_FOUND;
 	}
-	
+}
+
+short* AcquireBuffer(int engineID, int size)
+{
+	if (size < 0)
+	{
+		error_message = "Negative buffer size";
+		return NULL;
+	}
+	RecognizerRef pDecoder(engineID);
+	if (pDecoder.get() != NULL)
+	{
+		return pDecoder->AcquireBuffer(size)->pData_;
+	}
+	else
+	{
+		std::stringstream ss;
+		ss << "No engine with id - " << engineID;
+		error_message = ss.str();
+		return NULL;
+	}
+}
+
+ReturnStatus CommitBuffer(int engineID, const char* spkId, short* pData, int size)
+{
+	RecognizerRef pDecoder(engineID);
+	if (pDecoder.get() != NULL)
+	{
+		AudioBuffer* pBuffer = pDecoder->TakeAcquiredBuffer(pData);
+		if (pBuffer == NULL)
+		{
+			std::stringstream ss;
+			ss << "Buffer was not acquired from engine - " << engineID;
+			error_message = ss.str();
+			return ERROR_UNKNOWN;
+		}
+		if (size < 0 || size > pBuffer->capacity_)
+		{
+			std::stringstream ss;
+			ss << "Bad size " << size << " for a buffer of " << pBuffer->capacity_ << " samples";
+			error_message = ss.str();
+			// the buffer can't be committed any more, give it back to the pool
+			pDecoder->DiscardBuffer(pBuffer);
+			return ERROR_UNKNOWN;
+		}
+		pBuffer->spkr_ = spkId;
+		pBuffer->size_ = size;
+		pDecoder->ReceiveData(pBuffer);
+		return SUCCEED;
+	}
+	else
+	{
+		std::stringstream ss;
+		ss << "No engine with id - " << engineID;
+		error_message = ss.str();
+		return ERROR_ENGINE_NOT_FOUND;
+	}
 }
 
 ReturnStatus AddCallback(int engineID, DecoderSignal signal, DecoderSignalCallback callback)
 {
-	OnlineDecoder* pDecoder = GetEngine(engineID);
-	if (pDecoder != NULL)
+	RecognizerRef pDecoder(engineID);
+	if (pDecoder.get() != NULL)
 	{
 		pDecoder->AddCallBack(signal, callback);
 		return SUCCEED;
@@ -223,10 +278,27 @@ ReturnStatus AddCallback(int engineID, DecoderSignal signal, DecoderSignalCallba
 	
 }
 
+ReturnStatus AddFullResultCallback(int engineID, FullResultCallback callback)
+{
+	RecognizerRef pDecoder(engineID);
+	if (pDecoder.get() != NULL)
+	{
+		pDecoder->AddFullResultCallBack(callback);
+		return SUCCEED;
+	}
+	else
+	{
+		std::stringstream ss;
+		ss << "No engine with id - " << engineID;
+		error_message = ss.str();
+		return ERROR_ENGINE_NOT_FOUND;
+	}
+}
+
 ReturnStatus ChangePartialStatus(int engineID) 
 {
-  OnlineDecoder* pDecoder = GetEngine(engineID);
-  if (pDecoder != NULL)
+  RecognizerRef pDecoder(engineID);
+  if (pDecoder.get() != NULL)
 	{
 		pDecoder->ChangePartial();
 		return SUCCEED;
@@ -240,6 +312,60 @@ ReturnStatus ChangePartialStatus(int engineID)
 	}
 }
 
+ReturnStatus GetRecognizerStats(int engineID, RecogStats* stats)
+{
+  RecognizerRef pDecoder(engineID);
+  if (pDecoder.get() != NULL)
+	{
+		pDecoder->GetStats(stats);
+		return SUCCEED;
+	}
+	else
+	{
+		std::stringstream ss;
+		ss << "No engine with id - " << engineID;
+		error_message = ss.str();
+		return ERROR_ENGINE_NOT_FOUND;
+	}
+}
+
+ReturnStatus GetDispatcherStats(DispatcherStats* stats)
+{
+	ResultDispatcher *dispatcher = ResultDispatcher::Existing();
+	if (dispatcher == NULL)
+	{
+		error_message = "No result delivery threads, async-callbacks is not set";
+		return ERROR_ENGINE_NOT_FOUND;
+	}
+	ResultDispatcherStats dispatcher_stats;
+	dispatcher->GetStats(&dispatcher_stats);
+	stats->num_dispatched = dispatcher_stats.num_dispatched;
+	stats->num_delivered = dispatcher_stats.num_delivered;
+	stats->num_dropped = dispatcher_stats.num_dropped;
+	stats->max_queue_length = dispatcher_stats.max_queue_length;
+	stats->average_lag = dispatcher_stats.num_delivered == 0 ? 0.0 :
+		dispatcher_stats.total_lag_secs / dispatcher_stats.num_delivered;
+	stats->max_lag = dispatcher_stats.max_lag_secs;
+	return SUCCEED;
+}
+
+ReturnStatus SetStageTiming(int engineID, int enable)
+{
+  RecognizerRef pDecoder(engineID);
+  if (pDecoder.get() != NULL)
+	{
+		pDecoder->SetStageTiming(enable != 0);
+		return SUCCEED;
+	}
+	else
+	{
+		std::stringstream ss;
+		ss << "No engine with id - " << engineID;
+		error_message = ss.str();
+		return ERROR_ENGINE_NOT_FOUND;
+	}
+}
+
 const char* GetLastErrMsg() {
   return error_message.c_str();
 }
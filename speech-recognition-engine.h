@@ -13,6 +13,88 @@ enum DecoderSignal {
 // callback function type definitions
 typedef void(*DecoderSignalCallback)(int id, const char* pszResults);
 
+// called when the engine is done with the samples given to AddBufferNoCopy
+typedef void(*AudioReleaseCallback)(const short* pData, void* user_data);
+
+// the full final result as plain structs, the same content as the JSON of
+// FULL_FINAL_RESULT_SIGNAL; times are in seconds
+typedef struct _RecogAlignmentEntry RecogAlignmentEntry;
+typedef struct _RecogHypothesis RecogHypothesis;
+typedef struct _RecogResult RecogResult;
+
+// a word or phone of a hypothesis; start, length and confidence are -1 for
+// the words when no word-boundary-file is set
+struct _RecogAlignmentEntry {
+	int id;
+	const char* symbol;
+	float start;
+	float length;
+	float confidence;
+};
+
+struct _RecogHypothesis {
+	const char* transcript;
+	float likelihood;
+	int num_words;
+	const RecogAlignmentEntry* words;
+	// 0 unless phone alignment is done for this hypothesis
+	int num_phones;
+	const RecogAlignmentEntry* phones;
+};
+
+struct _RecogResult {
+	const char* speaker;
+	float segment_start;
+	float segment_length;
+	float total_length;
+	int num_hypotheses;
+	const RecogHypothesis* hypotheses;
+};
+
+// gets the full final result; everything it points to is owned by the
+// engine and only valid until the callback returns
+typedef void(*FullResultCallback)(int id, const RecogResult* result);
+
+// live statistics of a recognizer, from GetRecognizerStats; times are in
+// seconds and count from the creation of the recognizer
+typedef struct _RecogStats RecogStats;
+
+struct _RecogStats {
+	// audio given to the recognizer and audio decoded so far
+	double audio_received;
+	double audio_decoded;
+	// samples received and not read by the decoder yet
+	int queued_samples;
+	// decoding time per second of audio, over about the last second of audio
+	// and since the start
+	float real_time_factor;
+	float average_real_time_factor;
+	int frames_decoded;
+	// tokens held by the search, over the frames not pruned yet
+	int active_tokens;
+	// time since the last partial and final result, -1 if there was none
+	double since_last_partial;
+	double since_last_final;
+};
+
+// counters of the result delivery threads shared by the recognizers with
+// async-callbacks=true, from GetDispatcherStats; they count from the start of
+// the threads. The lag of a result is the time from the end of its decoding
+// to the start of its first callback, in seconds
+typedef struct _DispatcherStats DispatcherStats;
+
+struct _DispatcherStats {
+	long long num_dispatched;
+	long long num_delivered;
+	// partial results dropped with callback-overflow=drop-partial
+	long long num_dropped;
+	// most results waiting on one delivery thread
+	int max_queue_length;
+	// over the delivered results
+	double average_lag;
+	double max_lag;
+};
+
 // return flag, if you get an ERROR_XXXX return status, 
 // you can get more information by calling GetLastErrMsg.
 enum ReturnStatus
@@ -42,8 +124,35 @@ ReturnStatus FreeRecognizer(int engineID);
 
 ReturnStatus AddBuffer(int engineID, const char* spkId, const short* pData, int size);
 
+// hand the samples to the engine without copying; they must stay valid until
+// release(pData, user_data) is called, which happens on a decoding thread
+ReturnStatus AddBufferNoCopy(int engineID, const char* spkId, const short* pData, int size,
+                             AudioReleaseCallback release, void* user_data);
+
+// get room for size samples from the recognizer's buffer pool, write the
+// samples into it and pass it to CommitBuffer; NULL if engineID is invalid
+short* AcquireBuffer(int engineID, int size);
+
+// queue a buffer returned by AcquireBuffer, size can be smaller than requested;
+// on error the buffer is given back to the pool and must not be used again
+ReturnStatus CommitBuffer(int engineID, const char* spkId, short* pData, int size);
+
 ReturnStatus AddCallback(int engineID, DecoderSignal signal, DecoderSignalCallback callback);
 
+// called with each full final result, like FULL_FINAL_RESULT_SIGNAL but
+// without going through JSON
+ReturnStatus AddFullResultCallback(int engineID, FullResultCallback callback);
+
 ReturnStatus ChangePartialStatus(int engineID);
 
+// can be called at any time, also while the recognizer is decoding
+ReturnStatus GetRecognizerStats(int engineID, RecogStats* stats);
+
+// ERROR_ENGINE_NOT_FOUND if no recognizer has used async-callbacks=true
+ReturnStatus GetDispatcherStats(DispatcherStats* stats);
+
+// switch the per-stage timing histograms of a recognizer on (enable != 0) or
+// off, also while it is decoding
+ReturnStatus SetStageTiming(int engineID, int enable);
+
 #endif
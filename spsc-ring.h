@@ -0,0 +1,62 @@
+// 张; 杨
+#ifndef KALDI_SPSC_RING_H_
+#define KALDI_SPSC_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace kaldi {
+
+/// Bounded lock-free queue for exactly one producer thread and one consumer
+/// thread. The capacity is rounded up to a power of two. TryPush and TryPop
+/// never block; callers decide how to wait.
+template <typename T>
+class SpscRing {
+ public:
+  explicit SpscRing(size_t capacity): head_(0), tail_(0) {
+    size_t size = 1;
+    while (size < capacity)
+      size <<= 1;
+    slots_.resize(size);
+    mask_ = size - 1;
+  }
+
+  // producer side; false if the ring is full
+  bool TryPush(const T &item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == slots_.size())
+      return false;
+    slots_[tail & mask_] = item;
+    // seq_cst, so that a consumer that went to sleep after this store can be
+    // seen by the producer's check for sleepers
+    tail_.store(tail + 1, std::memory_order_seq_cst);
+    return true;
+  }
+
+  // consumer side; false if the ring is empty
+  bool TryPop(T *item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+      return false;
+    *item = slots_[head & mask_];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool Empty() const {
+    return head_.load(std::memory_order_seq_cst) == tail_.load(std::memory_order_seq_cst);
+  }
+
+ private:
+  std::vector<T> slots_;
+  size_t mask_;
+  // the indices only grow; head_ is written by the consumer and tail_ by the
+  // producer, and they sit on separate cache lines
+  alignas(64) std::atomic<size_t> head_;
+  alignas(64) std::atomic<size_t> tail_;
+};
+
+}
+
+#endif  // KALDI_SPSC_RING_H_
@@ -0,0 +1,83 @@
+// 张; 杨
+#include "onlinedecoder/stage-timing.h"
+
+namespace kaldi {
+
+const char *DecoderStageName(DecoderStage stage) {
+	static const char *kNames[kNumDecoderStages] = {
+		"read-data",
+		"resample",
+		"accept-waveform",
+		"nnet",
+		"silence-weighting",
+		"advance-decoding",
+		"partial-result",
+		"finalize-decoding",
+		"get-lattice",
+		"rescore-lattice",
+		"nbest",
+		"json"
+	};
+	KALDI_ASSERT(stage >= 0 && stage < kNumDecoderStages);
+	return kNames[stage];
+}
+
+void StageHistogram::Reset() {
+	for (int32 b = 0; b < kNumBuckets; b++)
+		counts[b].store(0, std::memory_order_relaxed);
+	num_calls.store(0, std::memory_order_relaxed);
+	total_ns.store(0, std::memory_order_relaxed);
+	max_ns.store(0, std::memory_order_relaxed);
+}
+
+void StageHistogram::Add(uint64 ns) {
+	uint64 us = ns / 1000;
+	int32 bucket = 0;
+	while (us >= 2 && bucket < kNumBuckets - 1) {
+		us >>= 1;
+		bucket++;
+	}
+	// the feature and finalization threads add too, so no count may be lost
+	counts[bucket].fetch_add(1, std::memory_order_relaxed);
+	num_calls.fetch_add(1, std::memory_order_relaxed);
+	total_ns.fetch_add(ns, std::memory_order_relaxed);
+	uint64 max = max_ns.load(std::memory_order_relaxed);
+	while (ns > max && !max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+}
+
+double StageHistogram::PercentileUs(double fraction) const {
+	uint64 total = num_calls.load(std::memory_order_relaxed);
+	if (total == 0)
+		return 0.0;
+	uint64 needed = static_cast<uint64>(fraction * total + 0.5);
+	uint64 seen = 0;
+	for (int32 b = 0; b < kNumBuckets; b++) {
+		seen += counts[b].load(std::memory_order_relaxed);
+		if (seen >= needed && seen > 0 && b < kNumBuckets - 1)
+			return static_cast<double>(static_cast<uint64>(2) << b);
+	}
+	// the last bucket has no upper bound of its own
+	return max_ns.load(std::memory_order_relaxed) / 1000.0;
+}
+
+void StageTimers::Reset() {
+	for (int32 s = 0; s < kNumDecoderStages; s++)
+		histograms_[s].Reset();
+}
+
+void StageTimers::Write(std::ostream &os) const {
+	for (int32 s = 0; s < kNumDecoderStages; s++) {
+		const StageHistogram &histogram = histograms_[s];
+		uint64 num_calls = histogram.num_calls.load(std::memory_order_relaxed);
+		if (num_calls == 0)
+			continue;
+		os << DecoderStageName(static_cast<DecoderStage>(s)) << ": " << num_calls
+		   << " calls, mean " << histogram.total_ns.load(std::memory_order_relaxed) / 1000.0 / num_calls
+		   << " us, p50 < " << histogram.PercentileUs(0.50)
+		   << " us, p95 < " << histogram.PercentileUs(0.95)
+		   << " us, p99 < " << histogram.PercentileUs(0.99)
+		   << " us, max " << histogram.max_ns.load(std::memory_order_relaxed) / 1000.0 << " us\n";
+	}
+}
+
+}
@@ -0,0 +1,103 @@
+// 张; 杨
+#ifndef KALDI_STAGE_TIMING_H_
+#define KALDI_STAGE_TIMING_H_
+
+#include "base/kaldi-common.h"
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+
+namespace kaldi {
+
+/// The hot-path stages of a recognizer that are timed.
+enum DecoderStage {
+	kStageReadData,
+	kStageResample,
+	kStageAcceptWaveform,
+	kStageNnet,
+	kStageSilenceWeighting,
+	kStageAdvanceDecoding,
+	kStagePartialResult,
+	kStageFinalizeDecoding,
+	kStageGetLattice,
+	kStageRescoreLattice,
+	kStageNbest,
+	kStageJson,
+	kNumDecoderStages
+};
+
+const char *DecoderStageName(DecoderStage stage);
+
+/// Durations of one stage in buckets of powers of two microseconds: bucket 0
+/// counts durations under 2 us, bucket b those from 2^b to 2^(b+1) us and the
+/// last bucket everything longer. The counters are atomic, so any thread of
+/// the recognizer may add to them while they are read.
+struct StageHistogram {
+	static const int32 kNumBuckets = 24;
+
+	std::atomic<uint64> counts[kNumBuckets];
+	std::atomic<uint64> num_calls;
+	std::atomic<uint64> total_ns;
+	std::atomic<uint64> max_ns;
+
+	StageHistogram() { Reset(); }
+
+	void Reset();
+	void Add(uint64 ns);
+
+	// upper bound in microseconds of the bucket holding the given fraction
+	// of the calls, 0 if there were none
+	double PercentileUs(double fraction) const;
+};
+
+/// Per-recognizer histograms of the stage durations. Timing is off until
+/// SetEnabled(true), and costs one relaxed atomic load per stage while off.
+class StageTimers {
+ public:
+	StageTimers(): enabled_(false) {}
+
+	void SetEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+	bool Enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+	void Add(DecoderStage stage, uint64 ns) { histograms_[stage].Add(ns); }
+	const StageHistogram &Histogram(DecoderStage stage) const { return histograms_[stage]; }
+
+	void Reset();
+
+	// one line per stage that was called: calls, mean, p50/p95/p99 and max
+	void Write(std::ostream &os) const;
+
+ private:
+	std::atomic<bool> enabled_;
+	StageHistogram histograms_[kNumDecoderStages];
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(StageTimers);
+};
+
+/// Times the enclosing scope as one call of a stage, if timing is on.
+class ScopedStageTimer {
+ public:
+	ScopedStageTimer(StageTimers *timers, DecoderStage stage):
+		timers_(timers->Enabled() ? timers : NULL), stage_(stage) {
+		if (timers_ != NULL)
+			start_ = std::chrono::steady_clock::now();
+	}
+	~ScopedStageTimer() {
+		if (timers_ != NULL) {
+			std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start_;
+			timers_->Add(stage_, elapsed.count());
+		}
+	}
+
+ private:
+	StageTimers *timers_;
+	DecoderStage stage_;
+	std::chrono::steady_clock::time_point start_;
+
+	KALDI_DISALLOW_COPY_AND_ASSIGN(ScopedStageTimer);
+};
+
+}
+
+#endif  // KALDI_STAGE_TIMING_H_